@@ -6,6 +6,9 @@
 #include <cstdlib>
 #include <ctime>
 #include <list>
+#include <algorithm>
+#include <random>
+#include <thread>
 
 #include "shader.h"
 #include "geometry.h"
@@ -13,6 +16,22 @@
 #include "renderer.h"
 #include "texture.h"
 #include "projectile.h"
+#include "towers.h"
+#include "stats.h"
+#include "frustum.h"
+#include "staticbatch.h"
+#include "gpuculling.h"
+#include "occlusion.h"
+#include "hwocclusion.h"
+#include "shadows.h"
+#include "skybox.h"
+#include "lights.h"
+#include "deferred.h"
+#include "clustered.h"
+#include "spatialgrid.h"
+#include "monsters.h"
+#include "simulation.h"
+#include "benchmarks.h"
 #include "OBJloader.h"  //For loading .obj files
 #include "OBJloaderV2.h"  //For loading .obj files using a polygon list format
 
@@ -35,12 +54,6 @@ static mat4 RX(float deg){ return glm::rotate(glm::mat4(1.0f), glm::radians(deg)
 static mat4 RY(float deg){ return glm::rotate(glm::mat4(1.0f), glm::radians(deg), glm::vec3(0,1,0)); }
 static mat4 S(const glm::vec3& s){ return glm::scale(glm::mat4(1.0f), s); }
 
-
-struct Tower {
-    vec3 position;
-    float height;
-};
-
 // Texture Index
 // -------------
 constexpr int GRASS_TEX_SLOT = 0;
@@ -52,6 +65,7 @@ constexpr int MONSTER_TEX_SLOT = 5;
 constexpr int JACK_O_LANTERN_TEX_SLOT = 6;
 constexpr int MESH_TEX_SLOT = 7;
 constexpr int GLOWSTONE_TEX_SLOT = 8;
+constexpr int SKYBOX_TEX_SLOT = 9;
 int CURRENT_CUBE_TEX_SLOT;
 
 //Texture ID declaration
@@ -70,6 +84,14 @@ GLuint glowstoneTextureID ;
 int flyingCubeTextureID;
 glm::vec3 flyingCubeColor(1.0f, 1.0f, 1.0f); // default white
 bool kKeyPressed = false; // to avoid multiple toggles per press
+bool mKeyPressed = false;
+bool cKeyPressed = false;
+bool oKeyPressed = false;
+bool bKeyPressed = false;
+bool pKeyPressed = false;
+bool yKeyPressed = false;
+bool zKeyPressed = false;
+bool lKeyPressed = false;
 
 // Variables to call and define later
 // ----------------------------------
@@ -77,44 +99,106 @@ GLFWwindow* window = nullptr;
 float spinningCubeAngle = 0.0f;
 Geometry geometry;
 GLuint lightCubeVAO;
+GLuint depthCubeVAO;                   // positions only cube for the shadow pass
 Shader* lightCubeShader;
 vector<Tower> towerList;
-list<Projectile> projectileList;
+TowerInstances towerInstances;
+AABBList towerBounds;                  // SoA copy of the tower boxes for culling
+SpatialGrid towerGrid;                 // XZ grid over towerBounds for spawn and collision queries
+FlowField monsterPaths;                // occupancy of the towers + where to walk to reach the camera, owned by the simulation
+vector<uint32_t> visibleCameraTowers;  // towers left after culling, per pass
+vector<uint32_t> visibleLightTowers[MAX_SHADOW_LAYERS];
+vector<uint32_t> shadowCasterTowers;   // union of the layer lists (per tower draws)
+vector<uint8_t> casterLayerSlots;      // per tower, bit i = in visibleLightTowers[i]
+size_t shadowCasterPairs = 0;          // (tower, layer) pairs drawn by the layered pass
+bool gFrustumCulling = true;           // toggled with C
+Frustum gCameraFrustum;
+CascadedShadowMap shadowCascades;      // shadows of both lights, one layer per light and view distance slice
+StaticBatch groundBatch;               // static geometry baked at startup (Batched mode)
+StaticBatch towerBatch;
+constexpr float STATIC_CHUNK_SIZE = 32.0f;
+GpuTowerCulling gpuTowers;             // GpuDriven mode, needs GL 4.3
+SoftwareOcclusion cameraOcclusion;     // CPU occlusion culling after the frustum test, toggled with O
+SoftwareOcclusion lightOcclusion;
+bool gOcclusionCulling = true;
+OcclusionQueries hwOcclusion;          // HwOcclusion mode, GL_ANY_SAMPLES_PASSED + conditional rendering
+size_t gMonsterQuerySlot = 0;
+constexpr float OCCLUSION_CLUSTER_SIZE = 16.0f;
+GpuTimer sceneGpuTimer;
+GpuTimer shadowGpuTimer;
+ShadowKernel gShadowKernel = ShadowKernel::Box4;  // shadow filtering variant, cycled with P
+GpuVariantBenchmark gpuBench;                     // --bench shadowkernels / skybox / prepass
+Skybox skybox;
+GpuTimer skyGpuTimer;
+GpuSampleCounter skySamples;                      // sky fragments shaded per frame
+bool gDepthPrepass = false;                       // toggled with Z
+GpuTimer prepassGpuTimer;
+LightingPath gLightingPath = LightingPath::Forward;  // cycled with L
+DeferredRenderer deferredRenderer;
+ClusteredLights clusteredLights;
+vector<PointLight> streetLamps;                   // static lights, built once with the city
+vector<PointLight> extraLights;                   // --lights N
+size_t gExtraLightsUsed = 0;
+vector<PointLight> projectileLights;              // one glow per projectile, rebuilt every frame
+vector<PointLight> visiblePointLights;            // this frame's point lights after culling
+GpuTimer lightingGpuTimer;
+TowerRenderMode gTowerMode = TowerRenderMode::Instanced;
+float gCityHalfExtent = 40.0f;         // towers are spread over [-extent, extent] in X and Z
+FrameStats frameStats;
+ProjectileInstances projectileInstances;
 
 // Turret state varaibles
 // ----------------------
 float gTurretBaseYawDeg = 0.0f;        // updated every frame
-float gTurretBarrelZDeg = 0.0f;        // controlled by Q/E, clamped to [-45, +45]
+float gTurretBarrelZDeg = 0.0f;        // Q/E turn it in the simulation, drawn from its snapshot, clamped to [-75, +75]
 GLuint gMetalTexID = 0;                // set after loading textures
 vec3 gTurretBasePos = glm::vec3(0.0f, 0.0f, 5.0f); // Right in front of the monster
 
 // Methods to call and define later
 // --------------------------------
 void processInput(GLFWwindow *window);
+void readSimulationInput(GLFWwindow *window, SimulationInput& input);
 bool InitContext();
-void renderScene(Shader& shader, const vector<Tower>& towers, GLuint vao, GLuint groundTex, GLuint buildingTex);
+void renderScene(Shader& shader, const vector<Tower>& towers, const vector<uint32_t>& visibleTowers, const Frustum& frustum, GLuint vao, GLuint groundTex, GLuint buildingTex, bool depthOnly = false);
 void renderLightCubes(Shader& shader, GLuint vao, const vec3& pos1, const vec3& pos2, GLuint tex);
 void renderProjectiles(Shader& shader, GLuint tex);
 void renderAvatar(Shader& shader);
-void renderMonster(Shader& shader, GLuint stoneVAO, int stoneVertices, GLuint tex, vec3 lightPos1, vec3 lightPos2);
-void renderSceneFromLight(Shader& shadowShader, const std::vector<Tower>& towers, GLuint cubeVAO);
-void renderMonsterFromLight(Shader& shadowShader, GLuint monsterVAO, int monsterVertexCount);
+void renderMonsters(Shader& shader, GLuint tex, vec3 lightPos1, vec3 lightPos2);
+void renderSceneFromLight(Shader& shadowShader, const std::vector<Tower>& towers, const Frustum* frustums, int layerCount, GLuint cubeVAO);
+void cullTowers(const Frustum& frustum, vector<uint32_t>& visibleTowers);
+void buildStaticBatches();
+void renderMonstersFromLight(Shader& shadowShader);
+void renderProjectilesFromLight(Shader& shadowShader);
+uint32_t shadowLayerMask(const vec3& center, const vec3& extent);
 void renderTurret(Shader& shader, GLuint cubeVAO, const glm::mat4& parentWorld, float baseYawDeg, float barrelZDeg, GLuint metalTexID);
-void renderTurretShadow(Shader& shadowShader, GLuint cubeVAO, const glm::mat4& parentWorld, float baseYawDeg, float barrelZDeg);
+void renderTurretShadow(Shader& shadowShader, GLuint cubeVAO, const glm::mat4& parentWorld, float baseYawDeg, float barrelZDeg, int instanceCount);
 static void computeTurretBarrelTipAndDir(const mat4& parentWorld, float baseYawDeg, float barrelZDeg, vec3& outTip, vec3& outDir);
-GLuint setupModelVBO(string path, int& vertexCount);
+GLuint setupModelVBO(string path, int& vertexCount, GLuint* depthVAO = nullptr);
 GLuint setupModelEBO(string path, int& vertexCount);
 
 // Screen Settings
 // ---------------
 const unsigned int SCR_WIDTH = 1024;
 const unsigned int SCR_HEIGHT = 768;
+constexpr float FOV_DEGREES = 70.0f;
+constexpr float NEAR_PLANE = 0.03f;
+constexpr float FAR_PLANE = 800.0f;
 
 // Camera Settings for View Transfom
 // ---------------------------------
 Camera camera;
 bool cameraFirstPerson = true;
-float dt;
+
+// Game simulation (simulation.h): runs in fixed steps on its own thread, reads
+// the input the main thread publishes and publishes the world snapshots the
+// frames are drawn from. alpha says how far between its last two steps the
+// frame is drawn.
+// ---------------------------------------------------------------------------
+GameSimulation simulation;
+TripleBuffer<SimulationInput> simulationInputs;
+TripleBuffer<WorldSnapshot> worldSnapshots;
+SimulationInput simulationInput;       // built by the main thread every frame
+float gSimulationAlpha = 1.0f;
 
 // Frame Parameters + Mouse Parameters
 // -----------------------------------
@@ -122,72 +206,97 @@ float lastFrameTime;
 int lastMouseLeftState;
 double lastMousePosX, lastMousePosY;
 
-// Monster state (position, scale, radius)
-// ---------------------------------------
-glm::vec3 gMonsterPos = glm::vec3(0.0f, 0.0f, 0.0f);
-constexpr float gMonsterScale = 0.5f;     // matches your render scale
-constexpr float gMonsterRadiusLocal = 2.0f; // tweak to fit your Stone.obj bounds
-inline float getMonsterRadiusWorld() {
-    return gMonsterRadiusLocal * gMonsterScale;
-}
+// Monsters: simulated by GameSimulation, drawn instanced (monsters.h)
+// -------------------------------------------------------------------
+MonsterInstances monsterInstances;
+float gMonsterSpawnMaxDist = 22.0f;     // grows with the wave so the monsters have room
 // This is to help monster stay on the ground and not float around
 // ---------------------------------------------------------------
 constexpr float GROUND_Y = -1.0f;
 constexpr float GROUND_THICK = 0.1f;
 inline float groundTopY() { return GROUND_Y + 0.5f * GROUND_THICK; }
 
-// Squared distance between XZ points
-// ----------------------------------
-float dist2_xz(const glm::vec3& a, const vec3& b) {
-    vec2 da(a.x, a.z), db(b.x, b.z);
-    vec2 d = da - db;
-    return glm::dot(d, d);
-}
-
-// Segment–sphere intersection (finite beam)
-// -----------------------------------------
-bool segmentHitsSphere(const glm::vec3& A, const glm::vec3& B,
-                              const glm::vec3& C, float R)
-{
-    vec3 AB = B - A;
-    float ab2 = dot(AB, AB);
-    if (ab2 == 0.0f) return glm::length2(C - A) <= R*R;
-    float t = dot(C - A, AB) / ab2;
-    t = clamp(t, 0.0f, 1.0f);
-    vec3 closest = A + t * AB;
-    return length2(C - closest) <= R*R;
-}
-
-// Random spawn away from center and towers
-// ----------------------------------------
+// Random spawn away from center and towers. Only the simulation spawns
+// monsters, it draws from its own generator instead of sharing rand()
+// with the main thread
+// --------------------------------------------------------------------
 vec3 randomMonsterSpawnNearCamera(const vec3& camPos, float minDist = 8.0f, float maxDist = 22.0f) {
+    static std::minstd_rand random(static_cast<unsigned>(time(nullptr)));
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
     for (int tries = 0; tries < 64; ++tries) {
-        float ang = ((float)rand() / RAND_MAX) * 6.2831853f;           // [0, 2π)
-        float rad = minDist + ((float)rand() / RAND_MAX) * (maxDist - minDist);
+        float ang = unit(random) * 6.2831853f;                         // [0, 2π)
+        float rad = minDist + unit(random) * (maxDist - minDist);
         vec3 p = camPos + vec3(std::cos(ang)*rad, 0.0f, std::sin(ang)*rad);
 
-        // keep away from towers a bit
-        bool ok = true;
-        for (const auto& t : towerList) {
-            if (dist2_xz(p, t.position) < (2.5f * 2.5f)) { ok = false; break; }
-        }
-        if (ok) return p;
+        // keep away from towers a bit (only the towers of the nearby grid cells are tested)
+        if (!towerGrid.anyWithinRadius(p.x, p.z, 1.5f)) return p;
     }
     return camPos + vec3(maxDist, 0.0f, 0.0f); // fallback
 }
 
-// Respawn Monster and keep him grounded
-// -------------------------------------
-void respawnMonster() {
-    vec3 p = randomMonsterSpawnNearCamera(camera.getPosition(), 8.0f, 22.0f);
-    p.y = groundTopY() + getMonsterRadiusWorld();  // center = ground top + radius
-    gMonsterPos = p;
+// Where a monster (re)spawns, kept grounded. Called by the simulation,
+// possibly on its thread (the tower grid is never modified after startup)
+// ----------------------------------------------------------------------
+vec3 monsterSpawnPoint(const vec3& cameraPosition) {
+    vec3 p = randomMonsterSpawnNearCamera(cameraPosition, 8.0f, gMonsterSpawnMaxDist);
+    p.y = groundTopY() + MONSTER_RADIUS;  // center = ground top + radius
+    return p;
 }
 
 // Main Function
 // -------------
-int main(){
-    
+int main(int argc, char** argv){
+
+    // Command line options
+    // --------------------
+    int numTowers = 100;
+    int numMonsters = 1;
+    bool simulationThread = std::thread::hardware_concurrency() > 1;
+    int numExtraLights = 0;
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--towers" && i + 1 < argc) numTowers = std::max(0, atoi(argv[++i]));
+        if (arg == "--monsters" && i + 1 < argc) numMonsters = std::clamp(atoi(argv[++i]), 0, static_cast<int>(MAX_MONSTERS));
+        if (arg == "--no-sim-thread") simulationThread = false;
+        if (arg == "--shadow-steps" && i + 1 < argc) shadowCascades.lightAngleSteps = std::max(1, atoi(argv[++i]));
+        if (arg == "--lights" && i + 1 < argc) numExtraLights = std::max(0, atoi(argv[++i]));
+        if (arg == "--lighting" && i + 1 < argc) {
+            string path = argv[++i];
+            std::transform(path.begin(), path.end(), path.begin(), ::tolower);
+            for (int p = 0; p < static_cast<int>(LightingPath::Count); ++p) {
+                string known = lightingPathName(static_cast<LightingPath>(p));
+                std::transform(known.begin(), known.end(), known.begin(), ::tolower);
+                if (path == known) gLightingPath = static_cast<LightingPath>(p);
+            }
+        }
+        if (arg == "--bench") {
+            string name = i + 1 < argc ? argv[i + 1] : "all";
+            if (!isGpuBenchmark(name)) return runBenchmark(name) ? 0 : -1;
+            // GPU benchmarks run in the game loop
+            if (name == "shadowkernels") {
+                vector<string> kernels;
+                for (int k = 0; k < static_cast<int>(ShadowKernel::Count); ++k) kernels.push_back(shadowKernelName(static_cast<ShadowKernel>(k)));
+                gpuBench.start(name, "shadow kernels, GPU time of the lit scene", kernels, { "scene ms" });
+                gShadowKernel = ShadowKernel::Off;
+            }
+            else if (name == "lights") {
+                gpuBench.start(name, "lighting paths with more and more point lights",
+                               { "forward", "deferred", "clustered", "deferred +256", "clustered +256", "deferred +1024", "clustered +1024" },
+                               { "point lights", "scene ms", "lighting ms", "total ms" });
+                numExtraLights = std::max(numExtraLights, 1024);
+            }
+            else if (name == "prepass") {
+                gpuBench.start(name, "depth pre-pass off vs on, GPU time of the scene", { "off", "on" }, { "prepass ms", "scene ms", "total ms" });
+                gDepthPrepass = false;
+            }
+            else {
+                gpuBench.start(name, "skybox drawn first vs last", { "first", "last" }, { "sky ms", "sky samples", "scene ms" });
+                skybox.drawFirst = true;
+            }
+            ++i;
+        }
+    }
+
     // Initialize GLFW and OpenGL version
     // ----------------------------------
     if (!InitContext()) return -1;
@@ -216,73 +325,114 @@ int main(){
     flyingCubeTextureID = lampTextureID;
     gMetalTexID = metalTextureID; 
     
-    // Create Framebuffer for shawfow mapping
-    // --------------------------------------
-    GLuint depthMapFBO;
-    glGenFramebuffers(1, &depthMapFBO);
-
-    // Create the depth texture
-    const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-    GLuint depthMap;
-    glGenTextures(1, &depthMap);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0,
-                GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
-    glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // Create the cascaded shadow map (depth texture array + framebuffer)
+    // -----------------------------------------------------------------
+    shadowCascades.create();
 
     // Build and Compile and Link Shaders
     // ----------------------------------
-    Shader lightingShaderProgram("Shaders/Phong.vert", "Shaders/Phong.frag");
-    Shader monsterShaderProgram("Shaders/Monster.vert","Shaders/Monster.frag");
-    Shader shadowShaderProgram("Shaders/ShadowDepth.vert", "Shaders/ShadowDepth.frag");
+    Shader lightingShaderProgram("Shaders/Phong.vert", "Shaders/Phong.frag", shadowKernelDefines(gShadowKernel));
+    Shader monsterShaderProgram("Shaders/Monster.vert","Shaders/Monster.frag", shadowKernelDefines(gShadowKernel));
+    Shader shadowShaderProgram = GLEW_ARB_shader_viewport_layer_array
+        ? Shader("Shaders/ShadowLayered.vert", "Shaders/ShadowDepth.frag")
+        : Shader("Shaders/ShadowLayered.vert", "Shaders/ShadowLayered.geom", "Shaders/ShadowDepth.frag");
+    Shader boundsShaderProgram("Shaders/ShadowDepth.vert", "Shaders/ShadowDepth.frag");  // occlusion query boxes
+    Shader depthPrepassProgram("Shaders/DepthPrepass.vert", "Shaders/ShadowDepth.frag");
+    Shader gbufferShaderProgram("Shaders/Phong.vert", "Shaders/GBuffer.frag");
+    Shader gbufferMonsterProgram("Shaders/Monster.vert", "Shaders/GBuffer.frag");
+    Shader clusteredShaderProgram("Shaders/Phong.vert", "Shaders/Phong.frag", shadowKernelDefines(gShadowKernel) + clusteredDefines());
+    Shader clusteredMonsterProgram("Shaders/Monster.vert", "Shaders/Monster.frag", shadowKernelDefines(gShadowKernel) + clusteredDefines());
     lightCubeShader = &lightingShaderProgram;
 
     // Manage Building Postions Generation
     // -----------------------------------
     srand(static_cast<unsigned>(time(0))); // RNG
-    int numTowers = 100;
-    float minDist = 5.0f;
-    float maxRange = 40.0f;
-    for (int i = 0; i < numTowers; ++i) {
-        float x = static_cast<float>((rand() % static_cast<int>(2 * maxRange)) - static_cast<int>(maxRange));
-        float z = static_cast<float>((rand() % static_cast<int>(2 * maxRange)) - static_cast<int>(maxRange));
-        if (glm::length(glm::vec2(x, z)) < minDist) continue;
-        float height = 5.0f + static_cast<float>(rand() % 20);
-        towerList.push_back({ glm::vec3(x, 0.0f, z), height });
-    }
-
-    respawnMonster();
+    gCityHalfExtent = generateTowers(numTowers, towerList);
+    towerInstances.create(geometry, towerList);
+    towerBounds.reserve(towerList.size());
+    for (const auto& tower : towerList)
+        towerBounds.push(tower.position, towerExtent(tower));
+    towerGrid.build(towerBounds);
+    const float flowMargin = 32.0f;        // room to walk around the city's edge
+    monsterPaths.build(towerBounds, MONSTER_RADIUS, vec2(-gCityHalfExtent - flowMargin), vec2(gCityHalfExtent + flowMargin));
+    cout << "CITY LOG: " << monsterPaths.width() << "x" << monsterPaths.height() << " flow field cells of "
+         << monsterPaths.cellSize() << " m" << endl;
+    buildStaticBatches();
+    gpuTowers.create(geometry, towerList);
+    cout << "CITY LOG: " << towerList.size() << " towers generated" << endl;
+    generateStreetLamps(towerList, gCityHalfExtent, streetLamps);
+    generateRandomLights(numExtraLights, gCityHalfExtent, extraLights);
+    gExtraLightsUsed = extraLights.size();
+    cout << "CITY LOG: " << streetLamps.size() << " street lamps, " << extraLights.size() << " extra lights" << endl;
+
+    gMonsterSpawnMaxDist = 22.0f + 2.0f * std::sqrt(static_cast<float>(numMonsters));
+    simulation.spawnPoint = monsterSpawnPoint;
+    simulation.flowRadius = gMonsterSpawnMaxDist + 16.0f;   // every monster is in it, with room for detours
 
     // Set up Models
     // -------------
     string monsterPath = "Models/Stone.obj";
     int stoneVertices;
+    GLuint stoneDepthVAO;
 
-    GLuint stoneVAO = setupModelVBO(monsterPath, stoneVertices);
+    GLuint stoneVAO = setupModelVBO(monsterPath, stoneVertices, &stoneDepthVAO);
+    monsterInstances.create(stoneVAO, stoneDepthVAO, stoneVertices, MAX_MONSTERS, MAX_SHADOW_LAYERS);
 
     // Set initial transformation matrices to shaders
     // ----------------------------------------------
-    mat4 projectionMatrix = glm::perspective(radians(70.0f), SCR_WIDTH * 1.0f / SCR_HEIGHT, 0.03f, 800.0f);
+    mat4 projectionMatrix = glm::perspective(radians(FOV_DEGREES), SCR_WIDTH * 1.0f / SCR_HEIGHT, NEAR_PLANE, FAR_PLANE);
     Renderer::setProjectionMatrix(lightingShaderProgram.getID(), projectionMatrix);
     Renderer::setProjectionMatrix(monsterShaderProgram.getID(), projectionMatrix);
+    Renderer::setProjectionMatrix(depthPrepassProgram.getID(), projectionMatrix);
+    Renderer::setProjectionMatrix(gbufferShaderProgram.getID(), projectionMatrix);
+    Renderer::setProjectionMatrix(gbufferMonsterProgram.getID(), projectionMatrix);
+    Renderer::setProjectionMatrix(clusteredShaderProgram.getID(), projectionMatrix);
+    Renderer::setProjectionMatrix(clusteredMonsterProgram.getID(), projectionMatrix);
+    glUniform1f(glGetUniformLocation(gbufferMonsterProgram.ID, "specularStrength"), 0.5f);  // like Monster.frag
     mat4 identity = mat4(1.0f);
     Renderer::setWorldMatrix(lightingShaderProgram.getID(), identity);
     Renderer::setWorldMatrix(monsterShaderProgram.getID(), identity);
+    Renderer::setWorldMatrix(gbufferShaderProgram.getID(), identity);
+    Renderer::setWorldMatrix(gbufferMonsterProgram.getID(), identity);
+    Renderer::setWorldMatrix(clusteredShaderProgram.getID(), identity);
+    Renderer::setWorldMatrix(clusteredMonsterProgram.getID(), identity);
+
+    // The shadow kernel is compiled into the lighting programs, switching it
+    // relinks them in place (same program IDs) and restores their uniforms
+    // ----------------------------------------------------------------------
+    ShadowKernel appliedShadowKernel = gShadowKernel;
+    auto applyShadowKernel = [&]() {
+        if (gShadowKernel == appliedShadowKernel) return;
+        lightingShaderProgram.relink("Shaders/Phong.vert", "Shaders/Phong.frag", shadowKernelDefines(gShadowKernel));
+        monsterShaderProgram.relink("Shaders/Monster.vert", "Shaders/Monster.frag", shadowKernelDefines(gShadowKernel));
+        clusteredShaderProgram.relink("Shaders/Phong.vert", "Shaders/Phong.frag", shadowKernelDefines(gShadowKernel) + clusteredDefines());
+        clusteredMonsterProgram.relink("Shaders/Monster.vert", "Shaders/Monster.frag", shadowKernelDefines(gShadowKernel) + clusteredDefines());
+        deferredRenderer.setShadowKernel(gShadowKernel);
+        for (Shader* shader : { &lightingShaderProgram, &monsterShaderProgram, &clusteredShaderProgram, &clusteredMonsterProgram }) {
+            Renderer::setProjectionMatrix(shader->getID(), projectionMatrix);
+            Renderer::setWorldMatrix(shader->getID(), identity);
+        }
+        appliedShadowKernel = gShadowKernel;
+        cout << "RENDER LOG: Shadow kernel set to " << shadowKernelName(gShadowKernel) << endl;
+    };
 
     // Set up Vertex Data (buffers)
     // ----------------------------
     lightCubeVAO = geometry.createLightCube();
+    depthCubeVAO = geometry.createDepthCube();
+    projectileInstances.create(geometry, MAX_PROJECTILES, MAX_SHADOW_LAYERS);
+    hwOcclusion.create(geometry, towerList, OCCLUSION_CLUSTER_SIZE, &boundsShaderProgram, lightCubeVAO);
+    gMonsterQuerySlot = hwOcclusion.addObject();
+    skybox.create(geometry);
+    deferredRenderer.create(geometry, SCR_WIDTH, SCR_HEIGHT, gShadowKernel);
+    clusteredLights.create();
+    auto drawSky = [&](const mat4& view, const mat4& projection) {
+        skyGpuTimer.begin();
+        skySamples.begin();
+        skybox.draw(view, projection, SKYBOX_TEX_SLOT);
+        skySamples.end();
+        skyGpuTimer.end();
+    };
 
     // Frame time calculations for mouse (Comes with Frame Parameters at the top of this file)
     // ---------------------------------------------------------------------------------------
@@ -306,17 +456,84 @@ int main(){
     // Clamp rotation limits right away
     gTurretBarrelZDeg = clamp(gTurretBarrelZDeg, -75.0f, 75.0f);
 
+    // Start the simulation from here (on its own thread unless there is a single core)
+    // -------------------------------------------------------------------------------
+    simulation.reset(&towerGrid, &monsterPaths, camera.position, gTurretBarrelZDeg, numMonsters, worldSnapshots);
+    cout << "MONSTER LOG: " << simulation.monsterCount() << " monsters spawned" << endl;
+    simulationInputs.writeBuffer() = simulationInput;
+    simulationInputs.publish();
+    if (simulationThread) simulation.start(simulationInputs, worldSnapshots);
+    cout << "SIMULATION LOG: " << SIMULATION_HZ << " Hz fixed steps on "
+         << (simulation.threaded() ? "their own thread" : "the main thread") << endl;
+    WorldSnapshot reported;                // totals already added to the stats
+
     // Render Loop
     // -----------
     while(!glfwWindowShouldClose(window)){
         // Frame time calculation
         // ----------------------
-        dt = glfwGetTime() - lastFrameTime;
-        lastFrameTime += dt;
-
-        // Process Input
-        // -------------
-        processInput(window);
+        double frameSeconds = glfwGetTime() - lastFrameTime;
+        lastFrameTime += frameSeconds;
+        frameStats.beginFrame();
+
+        // Process Input, the camera stays still while the kernels are benchmarked
+        // ------------------------------------------------------------------------
+        if (gpuBench.running() && gpuBench.benchmark() == "shadowkernels")
+            gShadowKernel = static_cast<ShadowKernel>(gpuBench.variant());
+        else if (gpuBench.running() && gpuBench.benchmark() == "prepass")
+            gDepthPrepass = gpuBench.variant() == 1;
+        else if (gpuBench.running() && gpuBench.benchmark() == "lights") {
+            static const LightingPath paths[] = { LightingPath::Forward, LightingPath::Deferred, LightingPath::Clustered,
+                                                  LightingPath::Deferred, LightingPath::Clustered, LightingPath::Deferred, LightingPath::Clustered };
+            static const size_t extraLightCounts[] = { 0, 0, 0, 256, 256, 1024, 1024 };
+            gLightingPath = paths[gpuBench.variant()];
+            gExtraLightsUsed = std::min(extraLights.size(), extraLightCounts[gpuBench.variant()]);
+        }
+        else if (gpuBench.running())
+            skybox.drawFirst = gpuBench.variant() == 0;
+        else processInput(window);
+        applyShadowKernel();
+
+        // Hand this frame's input to the simulation. Without its thread, run the
+        // fixed steps of 1/120 s the frame's time pays for right here (none on
+        // some frames, several on slow ones). The camera stays still while
+        // benchmarking.
+        // -----------------------------------------------------------------------
+        double simulationStart = glfwGetTime();
+        readSimulationInput(window, simulationInput);
+        simulationInput.active = !gpuBench.running();
+        simulationInputs.writeBuffer() = simulationInput;
+        simulationInputs.publish();
+        if (!simulation.threaded()) {
+            simulationInputs.acquire();
+            simulation.update(simulationInputs.readBuffer(), worldSnapshots);
+        }
+        worldSnapshots.acquire();
+        const WorldSnapshot& world = worldSnapshots.readBuffer();
+        double renderStart = glfwGetTime();
+        frameStats.add("sim wait ms", 1000.0 * (renderStart - simulationStart));
+        frameStats.add("sim ms", 1000.0 * (world.simSeconds - reported.simSeconds));
+        frameStats.add("sim steps", static_cast<double>(world.steps - reported.steps));
+        frameStats.add("monster hits", static_cast<double>(world.monsterHits - reported.monsterHits));
+        frameStats.add("projectile tower hits", static_cast<double>(world.towerHits - reported.towerHits));
+        frameStats.add("flow updates", static_cast<double>(world.flowUpdates - reported.flowUpdates));
+        frameStats.add("projectiles", world.projectiles.size());
+        reported.steps = world.steps;
+        reported.simSeconds = world.simSeconds;
+        reported.monsterHits = world.monsterHits;
+        reported.towerHits = world.towerHits;
+        reported.flowUpdates = world.flowUpdates;
+
+        // Draw the newest snapshot, between its last two steps
+        // ----------------------------------------------------
+        gSimulationAlpha = world.alpha(simulationNow());
+        camera.position = mix(world.previousCameraPosition, world.cameraPosition, gSimulationAlpha);
+        gTurretBarrelZDeg = mix(world.previousTurretBarrelZDeg, world.turretBarrelZDeg, gSimulationAlpha);
+        spinningCubeAngle = mix(world.previousSpinningCubeAngle, world.spinningCubeAngle, gSimulationAlpha);
+        float turretBarrelZDeg = gTurretBarrelZDeg;
+
+        // Stream this frame's projectiles once, the shadow and lighting passes both draw them instanced
+        projectileInstances.upload(world.projectiles, gSimulationAlpha);
 
         // Light Cube Variables
         // --------------------
@@ -326,41 +543,134 @@ int main(){
         vec3 lightPos1 = getLightPos(0.0f, time);
         vec3 lightPos2 = getLightPos(3.14f, time);
 
-        // Shadow Pass
-        // -----------
-        glm::vec3 lightPos = getLightPos(0.0f, time);
-        glm::mat4 lightProjection = glm::ortho(-40.0f, 40.0f, -40.0f, 40.0f, 1.0f, 100.0f);
-        glm::mat4 lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
-        glm::mat4 lightSpaceMatrix = lightProjection * lightView;
+        // Shadow Pass, fit the cascades of both lights to the camera. With the static
+        // cache the shadow directions follow the lights in quantized steps
+        // ---------------------------------------------------------------------------
+        double shadowStart = glfwGetTime();
+        const float lightOffsets[MAX_SHADOW_LIGHTS] = { 0.0f, 3.14f };
+        vec3 lightDirs[MAX_SHADOW_LIGHTS];
+        int lightSteps[MAX_SHADOW_LIGHTS];
+        for (int light = 0; light < shadowCascades.lightCount; ++light) {
+            lightSteps[light] = shadowCascades.quantizeLightAngle(time + lightOffsets[light]);
+            vec3 pos = shadowCascades.staticCache ? getLightPos(0.0f, shadowCascades.lightStepAngle(lightSteps[light]))
+                                                  : getLightPos(lightOffsets[light], time);
+            lightDirs[light] = glm::normalize(-pos);
+        }
+        shadowCascades.update(camera.getViewMatrix(), radians(FOV_DEGREES), SCR_WIDTH * 1.0f / SCR_HEIGHT, NEAR_PLANE, FAR_PLANE,
+                              lightDirs, lightSteps);
+        const int layerCount = shadowCascades.layerCount();
+        frameStats.add("static layers drawn", shadowCascades.rebuiltLayers());
+
+        // Layers whose static casters are drawn this frame (all of them without the cache)
+        int staticLayers[MAX_SHADOW_LAYERS], allLayers[MAX_SHADOW_LAYERS];
+        Frustum staticFrustums[MAX_SHADOW_LAYERS];
+        int staticLayerCount = 0;
+        for (int l = 0; l < layerCount; ++l) {
+            allLayers[l] = l;
+            if (!shadowCascades.needsStaticPass(l)) continue;
+            staticFrustums[staticLayerCount] = shadowCascades.frustum(l);
+            staticLayers[staticLayerCount++] = l;
+        }
 
-        // Render to depth map
-        // -------------------
+        // Cull the towers against every layer and the camera frustum, the shadow
+        // casters also have to throw their shadow into the layer's receivers.
+        // The layered pass draws every tower into the layers it was culled into.
+        // -------------------------------------------------------------------------
+        auto cullCasters = [&]() {
+            for (int i = 0; i < staticLayerCount; ++i) {
+                int l = staticLayers[i];
+                cullTowers(shadowCascades.frustum(l), visibleLightTowers[i]);
+                if (gFrustumCulling)
+                    frameStats.add("culled casters", cullShadowCasters(shadowCascades.receiverFrustum(l), towerBounds,
+                                                                       shadowCascades.lightDirection(l / shadowCascades.cascadeCount),
+                                                                       GROUND_Y, shadowCascades.maxShadowLength, visibleLightTowers[i]));
+            }
+        };
+        auto mergeCasters = [&]() {
+            shadowCasterPairs = 0;
+            for (int i = 0; i < staticLayerCount; ++i) shadowCasterPairs += visibleLightTowers[i].size();
+            if (gTowerMode == TowerRenderMode::PerTower)
+                listMasks(visibleLightTowers, staticLayerCount, towerList.size(), casterLayerSlots, shadowCasterTowers);
+        };
+        shadowCasterTowers.clear();
+        shadowCasterPairs = 0;
+        gCameraFrustum = Frustum::fromMatrix(projectionMatrix * camera.getViewMatrix());
+        if (gTowerMode == TowerRenderMode::GpuDriven) {
+            gpuTowers.cull(&gCameraFrustum, staticFrustums, staticLayerCount, gFrustumCulling);
+        }
+        else if (gTowerMode == TowerRenderMode::HwOcclusion) {
+            // the shadow pass draws instanced, the lighting pass relies on the queries
+            cullCasters();
+            mergeCasters();
+        }
+        else if (gTowerMode != TowerRenderMode::Batched) {   // batches cull whole chunks instead
+            cullCasters();
+            cullTowers(gCameraFrustum, visibleCameraTowers);
+            if (gOcclusionCulling) {
+                double occlusionStart = glfwGetTime();
+                for (int i = 0; i < staticLayerCount; ++i)
+                    frameStats.add("occluded (light)", lightOcclusion.cull(shadowCascades.matrix(staticLayers[i]), towerBounds, visibleLightTowers[i]));
+                frameStats.add("occluded (camera)", cameraOcclusion.cull(projectionMatrix * camera.getViewMatrix(), towerBounds, visibleCameraTowers));
+                frameStats.add("occlusion ms", 1000.0 * (glfwGetTime() - occlusionStart));
+            }
+            mergeCasters();
+        }
+
+        // Render every layer in one layered pass, each caster is instanced once per
+        // layer it was culled into. With the cache the towers go to the static array
+        // when a layer moved and the dynamic casters are drawn over a copy of it.
+        // ---------------------------------------------------------------------------
         shadowShaderProgram.use();
-        shadowShaderProgram.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+        glm::mat4 turretParentWorld = T(gTurretBasePos);
+        // Aim at the camera
+        f = normalize(camera.getlookAt());
+        gTurretBaseYawDeg = degrees(std::atan2(f.x, f.z));
 
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-        glClear(GL_DEPTH_BUFFER_BIT);
+        GLint prevCull; glGetIntegerv(GL_CULL_FACE_MODE, &prevCull);
+        shadowGpuTimer.begin();
 
         // Draw cubes (ground/buildings) with front-face culling to reduce acne
         glEnable(GL_CULL_FACE);
-        GLint prevCull; glGetIntegerv(GL_CULL_FACE_MODE, &prevCull);
         glCullFace(GL_FRONT);
 
-        renderSceneFromLight(shadowShaderProgram, towerList, lightCubeVAO);
+        if (!shadowCascades.staticCache) {
+            shadowCascades.beginLayered();
+        }
+        else if (staticLayerCount > 0) {
+            shadowCascades.beginStatic(staticLayers, staticLayerCount);
+        }
+        if (staticLayerCount > 0) {
+            shadowCascades.setLayers(shadowShaderProgram, staticLayers, staticLayerCount);
+            renderSceneFromLight(shadowShaderProgram, towerList, staticFrustums, staticLayerCount, depthCubeVAO);
+        }
+        if (shadowCascades.staticCache) shadowCascades.beginDynamic();
+
+        // Dynamic casters go to the layers they reach, slot = layer
+        shadowCascades.setLayers(shadowShaderProgram, allLayers, layerCount);
+        auto layersOf = [](const vec3& position, float radius) { return shadowLayerMask(position, vec3(radius)); };
+
+        // Projectiles
+        projectileInstances.uploadCasters(world.projectiles, layersOf, gSimulationAlpha);
+        renderProjectilesFromLight(shadowShaderProgram);
 
         // Turret into the shadow map
-        // --------------------------
-        glm::mat4 turretParentWorld = T(gTurretBasePos);
-        // Aim at the camera
-        f = normalize(camera.getlookAt());
-        gTurretBaseYawDeg = degrees(std::atan2(f.x, f.z));
-        renderTurretShadow(shadowShaderProgram, lightCubeVAO, turretParentWorld, gTurretBaseYawDeg, gTurretBarrelZDeg);
+        uint32_t turretLayers = shadowLayerMask(gTurretBasePos + vec3(0.0f, 1.0f, 0.0f), vec3(2.5f));
+        if (turretLayers) {
+            int instances = CascadedShadowMap::setDrawSlots(shadowShaderProgram, turretLayers);
+            renderTurretShadow(shadowShaderProgram, depthCubeVAO, turretParentWorld, gTurretBaseYawDeg, turretBarrelZDeg, instances);
+        }
 
-        // Draw the monster into the depth map too.
+        // Draw the monsters into the depth map too.
         // Disable culling for safety
-        glDisable(GL_CULL_FACE);
-        renderMonsterFromLight(shadowShaderProgram, stoneVAO, stoneVertices);
+        monsterInstances.uploadCasters(world.monsters, layersOf, gSimulationAlpha);
+        if (monsterInstances.casterCount() > 0) {
+            glDisable(GL_CULL_FACE);
+            renderMonstersFromLight(shadowShaderProgram);
+        }
+
+        shadowGpuTimer.end();
+        if (shadowGpuTimer.ready()) frameStats.add("gpu shadow ms", shadowGpuTimer.milliseconds());
+        frameStats.add("shadow cpu ms", 1000.0 * (glfwGetTime() - shadowStart));
 
         // Restore state
         glEnable(GL_CULL_FACE);
@@ -368,35 +678,93 @@ int main(){
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
         
-        // Light Pass + Renderer Clear
-        // ---------------------------
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
-        Renderer::clear(); // Clears color and depth buffers
+        // Point lights: the street lamps and a glow on every projectile in flight,
+        // culled against the camera frustum. The forward path ignores them.
+        // ------------------------------------------------------------------------
+        bool deferred = gLightingPath == LightingPath::Deferred && deferredRenderer.isReady();
+        bool clustered = gLightingPath == LightingPath::Clustered && clusteredLights.isReady();
+        visiblePointLights.clear();
+        if (deferred || clustered) {
+            cullPointLights(gCameraFrustum, streetLamps.data(), streetLamps.size(), visiblePointLights);
+            projectileLights.clear();
+            for (size_t i = 0; i < world.projectiles.size(); ++i)
+                projectileLights.push_back(makePointLight(world.projectiles.interpolatedPosition(i, gSimulationAlpha), PROJECTILE_LIGHT_RADIUS, PROJECTILE_LIGHT_COLOR, PROJECTILE_LIGHT_INTENSITY));
+            cullPointLights(gCameraFrustum, projectileLights.data(), projectileLights.size(), visiblePointLights);
+            cullPointLights(gCameraFrustum, extraLights.data(), gExtraLightsUsed, visiblePointLights);
+        }
+        frameStats.add("point lights", visiblePointLights.size());
+
+        // Clustered: list the lights of every cluster on the worker threads
+        // ------------------------------------------------------------------
+        if (clustered) {
+            double clusterStart = glfwGetTime();
+            clusteredLights.build(camera.getViewMatrix(), projectionMatrix, NEAR_PLANE, FAR_PLANE, visiblePointLights);
+            frameStats.add("cluster cpu ms", 1000.0 * (glfwGetTime() - clusterStart));
+            frameStats.add("cluster indices", clusteredLights.indexCount());
+            frameStats.add("max cluster lights", clusteredLights.maxClusterLights());
+            clusteredLights.upload();
+        }
+
+        // Light Pass + Renderer Clear. The deferred path draws the opaque
+        // geometry into the G-buffer and lights it after the monster.
+        // -----------------------------------------------------------------
+        if (deferred) deferredRenderer.beginGeometryPass();
+        else {
+            glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+            Renderer::clear(); // Clears color and depth buffers
+            if (skybox.drawFirst) drawSky(camera.getViewMatrix(), projectionMatrix);
+        }
+
+        // Depth pre-pass: lay down the scene depth with the position only path so the
+        // lighting pass shades every pixel once (GL_EQUAL, no depth writes). Not with
+        // the occlusion queries, a result arriving between the two passes could make
+        // them draw different clusters.
+        // ----------------------------------------------------------------------------
+        bool depthPrepass = gDepthPrepass && gTowerMode != TowerRenderMode::HwOcclusion;
+        frameStats.add("z prepass", depthPrepass ? 1.0 : 0.0);
+        if (depthPrepass) {
+            prepassGpuTimer.begin();
+            depthPrepassProgram.use();
+            Renderer::setViewMatrix(depthPrepassProgram.getID(), camera.getViewMatrix());
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            renderScene(depthPrepassProgram, towerList, visibleCameraTowers, gCameraFrustum, depthCubeVAO, 0, 0, true);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            prepassGpuTimer.end();
+            if (prepassGpuTimer.ready()) frameStats.add("gpu prepass ms", prepassGpuTimer.milliseconds());
+            glDepthFunc(GL_EQUAL);
+            glDepthMask(GL_FALSE);
+        }
 
         // Activate Shader to draw with colors or textures
         // -----------------------------------------------
-        lightingShaderProgram.use();
-        Renderer::setViewMatrix(lightingShaderProgram.getID(), camera.getViewMatrix());
+        Shader& sceneShader = deferred ? gbufferShaderProgram : clustered ? clusteredShaderProgram : lightingShaderProgram;
+        sceneShader.use();
+        Renderer::setViewMatrix(sceneShader.getID(), camera.getViewMatrix());
 
         // Set lighting uniforms
-        lightingShaderProgram.setVec3("lightPos1", lightPos1);
-        lightingShaderProgram.setVec3("lightPos2", lightPos2);
-        lightingShaderProgram.setVec3("viewPos", camera.getPosition());
-        lightingShaderProgram.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-        
-        glActiveTexture(GL_TEXTURE14); // set to free unit
-        glBindTexture(GL_TEXTURE_2D, depthMap);
-        lightingShaderProgram.setInt("shadowMap", 14);
+        if (!deferred) {
+            sceneShader.setVec3("lightPos1", lightPos1);
+            sceneShader.setVec3("lightPos2", lightPos2);
+            sceneShader.setVec3("viewPos", camera.getPosition());
+            shadowCascades.bind(sceneShader, 14); // set to free unit
+        }
+        if (clustered) clusteredLights.bind(sceneShader, SCR_WIDTH, SCR_HEIGHT);
 
-        
         // Render the scene
         // ----------------
-        renderScene(lightingShaderProgram, towerList, lightCubeVAO, grassTextureID, buildingTextureID);
+        sceneGpuTimer.begin();
+        renderScene(sceneShader, towerList, visibleCameraTowers, gCameraFrustum, lightCubeVAO, grassTextureID, buildingTextureID);
+        sceneGpuTimer.end();
+        if (depthPrepass) {
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+        }
+        if (sceneGpuTimer.ready()) frameStats.add("gpu scene ms", sceneGpuTimer.milliseconds());
         // Render the turret
         turretParentWorld = T(gTurretBasePos);
         f = normalize(camera.getlookAt());
         gTurretBaseYawDeg = degrees(std::atan2(f.x, f.z));
-        renderTurret(lightingShaderProgram, lightCubeVAO, turretParentWorld, gTurretBaseYawDeg, gTurretBarrelZDeg, gMetalTexID);
+        renderTurret(sceneShader, lightCubeVAO, turretParentWorld, gTurretBaseYawDeg, turretBarrelZDeg, gMetalTexID);
         // Compute turret tip & dir
         vec3 turretTip, turretDir;
         computeTurretBarrelTipAndDir(T(gTurretBasePos), gTurretBaseYawDeg, gTurretBarrelZDeg, turretTip, turretDir);
@@ -412,33 +780,98 @@ int main(){
                 vec3 direction = glm::normalize(camera.getlookAt());
                 vec3 velocity = direction * projectileSpeed;
                 vec3 spawnPosition = camera.getPosition() + direction * 2.0f;
-                projectileList.push_back(Projectile(spawnPosition, velocity, lightingShaderProgram.getID()));
+                projectiles.spawn(spawnPosition, velocity);
             }
             */
             // From the turret barrel tip
             {
-                vec3 velocity = turretDir * projectileSpeed;
-                vec3 spawnPosition = turretTip + turretDir * 0.2f; // nudge forward to avoid self-collision
-                projectileList.push_back(Projectile(spawnPosition, velocity, lightingShaderProgram.getID()));
+                // fired by the simulation on its next step
+                simulationInput.fire(turretTip + turretDir * 0.2f, // nudge forward to avoid self-collision
+                                     turretDir * projectileSpeed);
             }
         }
         lastMouseLeftState = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
 
         // Render the light cubes
         // ----------------------
-        renderLightCubes(*lightCubeShader, lightCubeVAO, lightPos1, lightPos2, flyingCubeTextureID);
+        renderLightCubes(deferred || clustered ? sceneShader : *lightCubeShader, lightCubeVAO, lightPos1, lightPos2, flyingCubeTextureID);
         // Render the projectiles
         // ----------------------
-        renderProjectiles(lightingShaderProgram, laserTextureID);
+        renderProjectiles(sceneShader, laserTextureID);
         // Render the avatar
         // -----------------
-        renderAvatar(lightingShaderProgram);
-        // Render the monster using a model
-        // --------------------------------
-        Renderer::setViewMatrix(monsterShaderProgram.getID(), camera.getViewMatrix());
-        monsterShaderProgram.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-        monsterShaderProgram.setInt("shadowMap", 14);
-        renderMonster(monsterShaderProgram, stoneVAO, stoneVertices, monsterTextureID, lightPos1, lightPos2);
+        renderAvatar(sceneShader);
+        // Render the monsters in view, instanced
+        // -------------------------------------
+        monsterInstances.uploadVisible(world.monsters, [](const vec3& position, float radius) {
+            return !gFrustumCulling || gCameraFrustum.intersectsAABB(position, vec3(radius));
+        }, gSimulationAlpha);
+        frameStats.add("monsters drawn", monsterInstances.visibleCount());
+        Shader& monsterShader = deferred ? gbufferMonsterProgram : clustered ? clusteredMonsterProgram : monsterShaderProgram;
+        monsterShader.use();
+        Renderer::setViewMatrix(monsterShader.getID(), camera.getViewMatrix());
+        if (!deferred) shadowCascades.bind(monsterShader, 14);
+        if (clustered) clusteredLights.bind(monsterShader, SCR_WIDTH, SCR_HEIGHT);
+        bool useQueries = gTowerMode == TowerRenderMode::HwOcclusion;
+        hwOcclusion.setBounds(gMonsterQuerySlot, monsterInstances.visibleCenter(), monsterInstances.visibleExtent());
+        if (useQueries) hwOcclusion.beginConditional(gMonsterQuerySlot);
+        renderMonsters(monsterShader, monsterTextureID, lightPos1, lightPos2);
+        if (useQueries) hwOcclusion.endConditional(gMonsterQuerySlot);
+
+        // Deferred: light the G-buffer with the two shadowed lights and the point lights
+        // --------------------------------------------------------------------------------
+        if (deferred) {
+            lightingGpuTimer.begin();
+            deferredRenderer.lightingPass(camera.getViewMatrix(), projectionMatrix, camera.getPosition(),
+                                          lightPos1, lightPos2, shadowCascades, visiblePointLights);
+            lightingGpuTimer.end();
+            if (lightingGpuTimer.ready()) frameStats.add("gpu lighting ms", lightingGpuTimer.milliseconds());
+        }
+
+        // Sky last, only the pixels nothing else covered pass the depth test.
+        // Always last when deferred, the G-buffer depth is only copied in the lighting pass.
+        // -----------------------------------------------------------------------------------
+        if (!skybox.drawFirst || deferred) drawSky(camera.getViewMatrix(), projectionMatrix);
+        if (skySamples.ready()) frameStats.add("sky samples", static_cast<double>(skySamples.samples()));
+        if (skyGpuTimer.ready()) frameStats.add("gpu sky ms", skyGpuTimer.milliseconds());
+
+        // GPU benchmarks, quit once every variant is measured
+        // ---------------------------------------------------
+        if (gpuBench.running()) {
+            bool ready = sceneGpuTimer.ready() && skyGpuTimer.ready();
+            if (gpuBench.benchmark() == "shadowkernels")
+                gpuBench.addFrame(ready, { sceneGpuTimer.milliseconds() });
+            else if (gpuBench.benchmark() == "lights") {
+                double lightingMs = deferred ? lightingGpuTimer.milliseconds() : 0.0;
+                gpuBench.addFrame(ready && (!deferred || lightingGpuTimer.ready()),
+                                  { static_cast<double>(visiblePointLights.size()), sceneGpuTimer.milliseconds(), lightingMs,
+                                    sceneGpuTimer.milliseconds() + lightingMs });
+            }
+            else if (gpuBench.benchmark() == "prepass") {
+                double prepassMs = gDepthPrepass ? prepassGpuTimer.milliseconds() : 0.0;
+                gpuBench.addFrame(ready && (!gDepthPrepass || prepassGpuTimer.ready()),
+                                  { prepassMs, sceneGpuTimer.milliseconds(), prepassMs + sceneGpuTimer.milliseconds() });
+            }
+            else
+                gpuBench.addFrame(ready, { skyGpuTimer.milliseconds(), static_cast<double>(skySamples.samples()), sceneGpuTimer.milliseconds() });
+            if (!gpuBench.running()) glfwSetWindowShouldClose(window, true);
+        }
+
+        // Occlusion queries for next frame, against the finished depth buffer
+        // --------------------------------------------------------------------
+        if (useQueries) {
+            hwOcclusion.issueQueries(projectionMatrix * camera.getViewMatrix(), gFrustumCulling ? &gCameraFrustum : nullptr, camera.getPosition());
+            frameStats.add("hidden clusters", hwOcclusion.hiddenClusters());
+            frameStats.add("hidden towers", hwOcclusion.hiddenTowers());
+            frameStats.add("hidden monster", hwOcclusion.hiddenObjects());
+        }
+
+        if (gTowerMode == TowerRenderMode::PerTower || gTowerMode == TowerRenderMode::Instanced) {
+            frameStats.add("visible (camera)", visibleCameraTowers.size());
+            frameStats.add("visible (light)", shadowCasterPairs);
+        }
+        frameStats.add("render cpu ms", 1000.0 * (glfwGetTime() - renderStart));
+        frameStats.endFrame(towerRenderModeName(gTowerMode), towerList.size());
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
@@ -449,11 +882,12 @@ int main(){
         // ---------------------------------------------
         double mousePosX, mousePosY;
         glfwGetCursorPos(window, &mousePosX, &mousePosY);
-        camera.updateOrientation(mousePosX, mousePosY, dt);
+        if (!gpuBench.running()) camera.updateOrientation(mousePosX, mousePosY);
     }
 
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
+    simulation.stop();
     glfwTerminate();
     return 0;
 }
@@ -464,24 +898,50 @@ int main(){
 
 // Draw the scene, ground, buildings and so on
 // -------------------------------------------
-void renderScene(Shader& shader, const vector<Tower>& towers, GLuint vao, GLuint groundTex, GLuint buildingTex) {
+void renderScene(Shader& shader, const vector<Tower>& towers, const vector<uint32_t>& visibleTowers, const Frustum& frustum, GLuint vao, GLuint groundTex, GLuint buildingTex, bool depthOnly) {
     mat4 identity = mat4(1.0f);
 
+    if (gTowerMode == TowerRenderMode::Batched) {
+        // Vertices are already in world space
+        shader.use();
+        shader.setVec3("overrideColor", glm::vec3(1.0f));
+        Renderer::setWorldMatrix(shader.getID(), identity);
+        const Frustum* cullFrustum = gFrustumCulling ? &frustum : nullptr;
+        if (!depthOnly) Renderer::bindTexture(shader.getID(), groundTex, "textureSampler", GRASS_TEX_SLOT);
+        groundBatch.draw(cullFrustum);
+        if (!depthOnly) Renderer::bindTexture(shader.getID(), buildingTex, "textureSampler", BUILDING_TEX_SLOT);
+        size_t chunks = towerBatch.draw(cullFrustum);
+        if (!depthOnly) frameStats.add("chunks (camera)", chunks);
+        glBindVertexArray(vao);
+        return;
+    }
+
     shader.setVec3("overrideColor", glm::vec3(1.0f));
-    mat4 groundMatrix = glm::scale(glm::translate(identity, vec3(0.0f, -1.0f, 0.0f)), vec3(100.0f, 0.1f, 100.0f));
+    float groundSize = 2.5f * gCityHalfExtent;
+    mat4 groundMatrix = glm::scale(glm::translate(identity, vec3(0.0f, -1.0f, 0.0f)), vec3(groundSize, 0.1f, groundSize));
     shader.use();
-    Renderer::bindTexture(shader.getID(), groundTex, "textureSampler", GRASS_TEX_SLOT);
+    if (!depthOnly) Renderer::bindTexture(shader.getID(), groundTex, "textureSampler", GRASS_TEX_SLOT);
     Renderer::setWorldMatrix(shader.getID(), groundMatrix);
     glBindVertexArray(vao);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    Renderer::drawArrays(GL_TRIANGLES, 0, 36);
 
     shader.setVec3("overrideColor", glm::vec3(1.0f));
 
-    Renderer::bindTexture(shader.getID(), buildingTex, "textureSampler", BUILDING_TEX_SLOT);
-    for (const auto& tower : towers) {
-        mat4 model = glm::scale(glm::translate(identity, tower.position), vec3(2.0f, tower.height, 2.0f));
+    if (!depthOnly) Renderer::bindTexture(shader.getID(), buildingTex, "textureSampler", BUILDING_TEX_SLOT);
+    if (gTowerMode == TowerRenderMode::Instanced || gTowerMode == TowerRenderMode::GpuDriven || gTowerMode == TowerRenderMode::HwOcclusion) {
+        shader.setInt("useInstancing", 1);
+        if (gTowerMode == TowerRenderMode::GpuDriven) gpuTowers.draw(GpuTowerCulling::CameraPass);
+        else if (gTowerMode == TowerRenderMode::HwOcclusion) hwOcclusion.drawTowers(gFrustumCulling ? &frustum : nullptr);
+        else towerInstances.draw(visibleTowers, depthOnly);
+        shader.setInt("useInstancing", 0);
+        glBindVertexArray(vao);
+        return;
+    }
+    for (uint32_t index : visibleTowers) {
+        const Tower& tower = towers[index];
+        mat4 model = glm::scale(glm::translate(identity, tower.position), vec3(TOWER_WIDTH, tower.height, TOWER_WIDTH));
         Renderer::setWorldMatrix(shader.getID(), model);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        Renderer::drawArrays(GL_TRIANGLES, 0, 36);
     }
 }
 
@@ -497,47 +957,26 @@ void renderLightCubes(Shader& shader, GLuint vao, const vec3& pos1, const vec3&
         mat4 model = scale(translate(identity, pos), vec3(0.5f));
         shader.setMat4("worldMatrix", model);
         glBindVertexArray(vao);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        Renderer::drawArrays(GL_TRIANGLES, 0, 36);
     };
     drawCube(pos1);
     drawCube(pos2);
 }
 
-// Draw Projectiles as they are shot
-// ---------------------------------
+// Draw Projectiles as they are shot (simulated at the start of the frame)
+// -----------------------------------------------------------------------
 void renderProjectiles(Shader& shader, GLuint tex){
     shader.use();
     Renderer::bindTexture(shader.getID(), tex, "textureSampler", LASER_TEX_SLOT);
-    // Update and draw projectiles
-    for (auto it = projectileList.begin(); it != projectileList.end(); /* no ++ here */) {
-        it->Update(dt);
-        it->Draw();
-
-        const glm::vec3& prev = it->prevPosition();
-        const glm::vec3& curr = it->position();
-        const float R = getMonsterRadiusWorld();
-
-        // hit test against monster (segment vs sphere)
-        if (segmentHitsSphere(prev, curr, gMonsterPos, R)) {
-            respawnMonster();                        // move monster
-            it = projectileList.erase(it);           // erase returns next iterator
-            continue;
-        }
-
-        // lifetime cull
-        if (glm::length2(curr) > 800.0f * 800.0f) {
-            it = projectileList.erase(it);
-            continue;
-        }
-        ++it; // only increment when we kept the element
-    }
+    shader.setInt("useProjectileInstancing", 1);
+    projectileInstances.draw();
+    shader.setInt("useProjectileInstancing", 0);
 }
 
 // Draw avatar in 1st or 3rd person
 // --------------------------------
 void renderAvatar(Shader& shader){
         
-    spinningCubeAngle += 180.0f * dt;
     // Draw avatar in view space for first person camera
     // and in world space for third person camera
     if (cameraFirstPerson){
@@ -558,7 +997,7 @@ void renderAvatar(Shader& shader){
         
         Renderer::setWorldMatrix(shader.getID(), spinningCubeWorldMatrix);
     }
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    Renderer::drawArrays(GL_TRIANGLES, 0, 36);
 
     // Set the view matrix for first and third person cameras
     // - In first person, camera lookat is set like below
@@ -579,63 +1018,125 @@ void renderAvatar(Shader& shader){
     Renderer::setViewMatrix(shader.getID(), viewMatrix);
 }
 
-// Render monster using an OBJ model
-// ---------------------------------
-void renderMonster(Shader& shader, GLuint stoneVAO, int stoneVertices, GLuint tex, vec3 lightPos1, vec3 lightPos2){
+// Render the monsters in view, one instanced draw of the OBJ model
+// ----------------------------------------------------------------
+void renderMonsters(Shader& shader, GLuint tex, vec3 lightPos1, vec3 lightPos2){
     shader.use();
 
     shader.setVec3("lightPos1", lightPos1);
     shader.setVec3("lightPos2", lightPos2);
     shader.setVec3("viewPos", camera.getPosition());
 
-    // Move the model within the world
-    // -------------------------------
-    mat4 monsterModelMatrix = translate(mat4(1.0f), gMonsterPos) *
-                            scale(mat4(1.0f), vec3(gMonsterScale)); // scale down
-    Renderer::setWorldMatrix(shader.getID(), monsterModelMatrix);
-
     Renderer::bindTexture(shader.getID(), tex, "textureSampler", MONSTER_TEX_SLOT);
 
-    //Draw the stored vertex objects
-    glBindVertexArray(stoneVAO);
+    // Each instance carries its position and scale, the vertex shader moves the model
+    // -------------------------------------------------------------------------------
+    shader.setInt("useInstancing", 1);
     //TODO3 Draw model as elements, instead of as arrays
-    glDrawArrays(GL_TRIANGLES, 0, stoneVertices);
-    glBindVertexArray(0);
+    monsterInstances.drawVisible();
+    shader.setInt("useInstancing", 0);
 }
 
 // Render scene from light for shadow mapping before rendering lighting
 // --------------------------------------------------------------------
-void renderSceneFromLight(Shader& shadowShader, const std::vector<Tower>& towers, GLuint cubeVAO)
+void renderSceneFromLight(Shader& shadowShader, const std::vector<Tower>& towers, const Frustum* frustums, int layerCount, GLuint cubeVAO)
 {
     glm::mat4 identity = glm::mat4(1.0f);
 
-    // Ground
-    glm::mat4 groundMatrix = glm::scale(glm::translate(identity, glm::vec3(0.0f, -1.0f, 0.0f)), glm::vec3(60.0f, 0.1f, 60.0f));
-    shadowShader.setMat4("worldMatrix", groundMatrix);
-    glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    // The ground is only a receiver, everything sits on top of it so it can't
+    // shadow anything and is left out of the depth map
 
-    // Buildings
-    for (const auto& tower : towers) {
+    // Chunks are repeated for the layers they touch
+    if (gTowerMode == TowerRenderMode::Batched) {
+        shadowShader.setMat4("worldMatrix", identity);
+        frameStats.add("chunks (light)", towerBatch.drawLayered(frustums, layerCount, gFrustumCulling, [&](uint32_t slots) {
+            return CascadedShadowMap::setDrawSlots(shadowShader, slots);
+        }));
+        return;
+    }
+
+    // Buildings, one (tower, layer) pair per layer a tower was culled into
+    if (gTowerMode == TowerRenderMode::Instanced || gTowerMode == TowerRenderMode::GpuDriven || gTowerMode == TowerRenderMode::HwOcclusion) {
+        shadowShader.setInt("useInstancing", 1);
+        shadowShader.setInt("useLayerSlots", 1);
+        if (gTowerMode == TowerRenderMode::GpuDriven) gpuTowers.draw(GpuTowerCulling::LightPass);
+        else towerInstances.drawLayered(visibleLightTowers, layerCount);
+        shadowShader.setInt("useLayerSlots", 0);
+        shadowShader.setInt("useInstancing", 0);
+        return;
+    }
+    glBindVertexArray(cubeVAO);
+    for (uint32_t index : shadowCasterTowers) {
+        const Tower& tower = towers[index];
         glm::mat4 towerMatrix = glm::translate(identity, tower.position);
-        towerMatrix = glm::scale(towerMatrix, glm::vec3(2.0f, tower.height, 2.0f));
+        towerMatrix = glm::scale(towerMatrix, glm::vec3(TOWER_WIDTH, tower.height, TOWER_WIDTH));
         shadowShader.setMat4("worldMatrix", towerMatrix);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        int instances = CascadedShadowMap::setDrawSlots(shadowShader, casterLayerSlots[index]);
+        Renderer::drawArraysInstanced(GL_TRIANGLES, 0, 36, instances);
     }
 
     glBindVertexArray(0);
 }
 
-// Render the monster into the shadow map (depth pass)
-// ---------------------------------------------------
-void renderMonsterFromLight(Shader& shadowShader, GLuint monsterVAO, int monsterVertexCount){
-    glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f))
-                    * glm::scale(glm::mat4(1.0f), glm::vec3(1.0f)); // must match lighting pass!
-    shadowShader.setMat4("worldMatrix", model);
+// Frustum cull the towers for one pass, or list them all when culling is off
+// --------------------------------------------------------------------------
+void cullTowers(const Frustum& frustum, vector<uint32_t>& visibleTowers) {
+    if (!gFrustumCulling) {
+        visibleTowers.resize(towerList.size());
+        for (size_t i = 0; i < visibleTowers.size(); ++i) visibleTowers[i] = static_cast<uint32_t>(i);
+        return;
+    }
+    cullAABBs(frustum, towerBounds, visibleTowers);
+}
 
-    glBindVertexArray(monsterVAO);
-    glDrawArrays(GL_TRIANGLES, 0, monsterVertexCount);
-    glBindVertexArray(0);
+// Bake the ground and the towers into pre-transformed static chunks
+// -----------------------------------------------------------------
+void buildStaticBatches() {
+    float groundSize = 2.5f * gCityHalfExtent;
+    groundBatch.build({ { vec3(0.0f, GROUND_Y, 0.0f), vec3(groundSize, GROUND_THICK, groundSize) } }, groundSize);
+
+    vector<StaticBox> boxes;
+    boxes.reserve(towerList.size());
+    for (const auto& tower : towerList)
+        boxes.push_back({ tower.position, vec3(TOWER_WIDTH, tower.height, TOWER_WIDTH) });
+    towerBatch.build(boxes, STATIC_CHUNK_SIZE);
+}
+
+// Render the monsters into the shadow map (depth pass)
+// ----------------------------------------------------
+void renderMonstersFromLight(Shader& shadowShader){
+    // One draw for every (monster, layer) pair, like the projectiles
+    shadowShader.setInt("useMonsterInstancing", 1);
+    shadowShader.setInt("useLayerSlots", 1);
+    monsterInstances.drawCasters();
+    shadowShader.setInt("useLayerSlots", 0);
+    shadowShader.setInt("useMonsterInstancing", 0);
+}
+
+// Projectiles into the layers of the shadow map they reach
+// --------------------------------------------------------
+void renderProjectilesFromLight(Shader& shadowShader){
+    // One draw for all of them, one instance per (projectile, layer) pair
+    shadowShader.setInt("useProjectileInstancing", 1);
+    shadowShader.setInt("useLayerSlots", 1);
+    projectileInstances.drawCasters();
+    shadowShader.setInt("useLayerSlots", 0);
+    shadowShader.setInt("useProjectileInstancing", 0);
+}
+
+// Layers (bit l = layer l) where a dynamic object's box is a caster: inside the
+// light volume with a shadow that can reach the part of the view the layer shades
+// -------------------------------------------------------------------------------
+uint32_t shadowLayerMask(const vec3& center, const vec3& extent) {
+    if (!gFrustumCulling) return (1u << shadowCascades.layerCount()) - 1u;
+    uint32_t layers = 0;
+    for (int l = 0; l < shadowCascades.layerCount(); ++l) {
+        if (!shadowCascades.frustum(l).intersectsAABB(center, extent)) continue;
+        int light = l / shadowCascades.cascadeCount, cascade = l % shadowCascades.cascadeCount;
+        vec3 sweep = shadowSweep(center, extent, shadowCascades.lightDirection(light), GROUND_Y, shadowCascades.maxShadowLength);
+        if (shadowCascades.sliceFrustum(cascade).intersectsSweptAABB(center, extent, sweep)) layers |= 1u << l;
+    }
+    return layers;
 }
 
 // Hierarchical turret, Base -> Barrel
@@ -651,7 +1152,7 @@ void renderTurret(Shader& shader, GLuint cubeVAO, const glm::mat4& parentWorld,
 
     Renderer::setWorldMatrix(shader.getID(), baseWorld);
     glBindVertexArray(cubeVAO);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    Renderer::drawArrays(GL_TRIANGLES, 0, 36);
 
     // Mount: sits on top of base
     glm::mat4 mountWorld = baseWorld *
@@ -659,7 +1160,7 @@ void renderTurret(Shader& shader, GLuint cubeVAO, const glm::mat4& parentWorld,
         S(glm::vec3(1.2f, 0.2f, 1.2f));
 
     Renderer::setWorldMatrix(shader.getID(), mountWorld);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    Renderer::drawArrays(GL_TRIANGLES, 0, 36);
 
     // Barrel:
     glm::mat4 barrelWorld = baseWorld *
@@ -669,16 +1170,16 @@ void renderTurret(Shader& shader, GLuint cubeVAO, const glm::mat4& parentWorld,
         S(vec3(0.25f, 2.0f, 0.25f));                                   // long Y box
 
     Renderer::setWorldMatrix(shader.getID(), barrelWorld);
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+    Renderer::drawArrays(GL_TRIANGLES, 0, 36);
 }
 
 // Render turret shadow before lighting
 // ------------------------------------
-void renderTurretShadow(Shader& shadowShader, GLuint cubeVAO, const glm::mat4& parentWorld, float baseYawDeg, float barrelZDeg){
+void renderTurretShadow(Shader& shadowShader, GLuint cubeVAO, const glm::mat4& parentWorld, float baseYawDeg, float barrelZDeg, int instanceCount){
     auto draw = [&](const glm::mat4& w){
         shadowShader.setMat4("worldMatrix", w);
         glBindVertexArray(cubeVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        Renderer::drawArraysInstanced(GL_TRIANGLES, 0, 36, instanceCount);
     };
 
     glm::mat4 baseWorld = parentWorld *
@@ -701,7 +1202,7 @@ void renderTurretShadow(Shader& shadowShader, GLuint cubeVAO, const glm::mat4& p
 
 // Set up model reading all vertices from a model file
 // ---------------------------------------------------
-GLuint setupModelVBO(string path, int& vertexCount) {
+GLuint setupModelVBO(string path, int& vertexCount, GLuint* depthVAO) {
 	std::vector<glm::vec3> vertices;
 	std::vector<glm::vec3> normals;
 	std::vector<glm::vec2> UVs;
@@ -739,6 +1240,16 @@ GLuint setupModelVBO(string path, int& vertexCount) {
 	glEnableVertexAttribArray(2);
 
 	glBindVertexArray(0); // Unbind VAO (it's always a good thing to unbind any buffer/array to prevent strange bugs, as we are using multiple VAOs)
+
+	//Optional positions only VAO for depth passes, shares the vertex VBO
+	if (depthVAO) {
+		glGenVertexArrays(1, depthVAO);
+		glBindVertexArray(*depthVAO);
+		glBindBuffer(GL_ARRAY_BUFFER, vertices_VBO);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (GLvoid*)0);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+	}
 	vertexCount = vertices.size();
 	return VAO;
 }
@@ -827,16 +1338,6 @@ void processInput(GLFWwindow *window)
     if (glfwGetKey(window, GLFW_KEY_2) == GLFW_PRESS)
         cameraFirstPerson = false;
 
-    // Turret barrel Z rotation with Q / E  (±75°)
-    const float barrelSpeed = 180.0f; // deg/sec
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
-        gTurretBarrelZDeg += barrelSpeed * dt;
-    }
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
-        gTurretBarrelZDeg -= barrelSpeed * dt;
-    }
-    gTurretBarrelZDeg = glm::clamp(gTurretBarrelZDeg, -75.0f, 75.0f);
-
     //Random color chang of cubes
     //---------------------------------------
     if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS && !kKeyPressed) {
@@ -870,9 +1371,118 @@ void processInput(GLFWwindow *window)
         kKeyPressed = false;
     }
 
-    // Use camera lookat and side vectors to update positions with ASDW + SHIFT
+    // Cycle how the towers are submitted (per tower / instanced / batched / GPU driven / occlusion queries)
+    // ---------------------------------------------------------------------------------------------------
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS && !mKeyPressed) {
+        mKeyPressed = true;
+        gTowerMode = static_cast<TowerRenderMode>((static_cast<int>(gTowerMode) + 1) % static_cast<int>(TowerRenderMode::Count));
+        if (gTowerMode == TowerRenderMode::GpuDriven && !gpuTowers.isReady())
+            gTowerMode = static_cast<TowerRenderMode>((static_cast<int>(gTowerMode) + 1) % static_cast<int>(TowerRenderMode::Count));
+        cout << "RENDER LOG: Tower mode set to " << towerRenderModeName(gTowerMode) << endl;
+    }
+    if (glfwGetKey(window, GLFW_KEY_M) == GLFW_RELEASE) {
+        mKeyPressed = false;
+    }
+
+    // Toggle frustum culling of the towers
+    // ------------------------------------
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS && !cKeyPressed) {
+        cKeyPressed = true;
+        gFrustumCulling = !gFrustumCulling;
+        cout << "RENDER LOG: Frustum culling " << (gFrustumCulling ? "on (" : "off (") << cullKernelName(bestCullKernel()) << ")" << endl;
+    }
+    if (glfwGetKey(window, GLFW_KEY_C) == GLFW_RELEASE) {
+        cKeyPressed = false;
+    }
+
+    // Toggle software occlusion culling of the towers
+    // -----------------------------------------------
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS && !oKeyPressed) {
+        oKeyPressed = true;
+        gOcclusionCulling = !gOcclusionCulling;
+        cout << "RENDER LOG: Software occlusion culling " << (gOcclusionCulling ? "on" : "off") << endl;
+    }
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_RELEASE) {
+        oKeyPressed = false;
+    }
+
+    // Toggle the cached static shadow map
+    // -----------------------------------
+    if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS && !bKeyPressed) {
+        bKeyPressed = true;
+        shadowCascades.staticCache = !shadowCascades.staticCache;
+        cout << "RENDER LOG: Static shadow cache " << (shadowCascades.staticCache ? "on" : "off") << endl;
+    }
+    if (glfwGetKey(window, GLFW_KEY_B) == GLFW_RELEASE) {
+        bKeyPressed = false;
+    }
+
+    // Cycle the shadow filtering kernel (off / 1-tap / 4-tap / rotated Poisson)
+    // -------------------------------------------------------------------------
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS && !pKeyPressed) {
+        pKeyPressed = true;
+        gShadowKernel = static_cast<ShadowKernel>((static_cast<int>(gShadowKernel) + 1) % static_cast<int>(ShadowKernel::Count));
+    }
+    if (glfwGetKey(window, GLFW_KEY_P) == GLFW_RELEASE) {
+        pKeyPressed = false;
+    }
+
+    // Draw the sky before the scene instead of after it (fill rate comparison)
     // ------------------------------------------------------------------------
-    camera.processInput(window);
+    if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS && !yKeyPressed) {
+        yKeyPressed = true;
+        skybox.drawFirst = !skybox.drawFirst;
+        cout << "RENDER LOG: Skybox drawn " << (skybox.drawFirst ? "first" : "last") << endl;
+    }
+    if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_RELEASE) {
+        yKeyPressed = false;
+    }
+
+    // Toggle the depth pre-pass of the scene
+    // --------------------------------------
+    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS && !zKeyPressed) {
+        zKeyPressed = true;
+        gDepthPrepass = !gDepthPrepass;
+        cout << "RENDER LOG: Depth pre-pass " << (gDepthPrepass ? "on" : "off") << endl;
+    }
+    if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_RELEASE) {
+        zKeyPressed = false;
+    }
+
+    // Cycle the lighting path (forward / deferred / clustered)
+    // --------------------------------------------
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS && !lKeyPressed) {
+        lKeyPressed = true;
+        do {
+            gLightingPath = static_cast<LightingPath>((static_cast<int>(gLightingPath) + 1) % static_cast<int>(LightingPath::Count));
+        } while ((gLightingPath == LightingPath::Deferred && !deferredRenderer.isReady()) ||
+                 (gLightingPath == LightingPath::Clustered && !clusteredLights.isReady()));
+        cout << "RENDER LOG: Lighting path set to " << lightingPathName(gLightingPath) << endl;
+    }
+    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_RELEASE) {
+        lKeyPressed = false;
+    }
+}
+
+// Held keys that move things, for the simulation to apply every step
+// -------------------------------------------------------------------
+void readSimulationInput(GLFWwindow *window, SimulationInput& input)
+{
+    // Turret barrel Z rotation with Q / E  (±75°)
+    input.barrelUp = glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS;
+    input.barrelDown = glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
+
+    // Camera lookat and side vectors move the camera with ASDW + SHIFT
+    // ----------------------------------------------------------------
+    input.forward = glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS;
+    input.back = glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS;
+    input.right = glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS;
+    input.left = glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS;
+    input.fast = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS;
+    input.lookAt = camera.lookAt;
+    input.sideVector = camera.sideVector;
+    input.walkSpeed = camera.speed;
+    input.fastSpeed = camera.fastSpeed;
 }
 
 // Initialize the libraries and window
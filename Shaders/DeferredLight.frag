@@ -0,0 +1,143 @@
+#version 330 core
+in vec2 TexCoord;
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+uniform mat4 view;
+
+uniform vec3 viewPos;
+uniform vec3 lightPos1;
+uniform vec3 lightPos2;
+
+// Cascaded shadow maps of both lights, layer = light * cascadeCount + cascade
+uniform sampler2DArrayShadow shadowMap;   // compares on lookup, every tap is a 2x2 PCF
+uniform mat4 lightSpaceMatrices[8];
+uniform float cascadeSplits[4];   // far view depth of each cascade
+uniform int cascadeCount;
+
+out vec4 FragColor;
+
+// G-buffer sample, rebuilt in world space
+vec3 FragPos;
+float ViewDepth;
+
+// simple normal-based bias to reduce acne
+float biasFromNormal(vec3 n, vec3 lightDir)
+{
+    float bias = max(0.005 * (1.0 - dot(normalize(n), normalize(lightDir))), 0.0005);
+    return bias;
+}
+
+// Shadow filtering kernel, set by the program as a compile-time variant:
+// 0 = no shadows, 1 = one bilinear tap, 2 = 4 taps, 3 = rotated Poisson disk
+#ifndef SHADOW_KERNEL
+#define SHADOW_KERNEL 2
+#endif
+
+const vec2 poissonDisk[8] = vec2[](
+    vec2(-0.613392, 0.617481), vec2(0.170019, -0.040254),
+    vec2(-0.299417, 0.791925), vec2(0.645680, 0.493210),
+    vec2(-0.651784, 0.717887), vec2(0.421003, 0.027070),
+    vec2(-0.817194, -0.271096), vec2(-0.705374, -0.668203)
+);
+
+// Fraction of the kernel that is lit, each tap compares refDepth in hardware
+float FilterShadow(vec2 uv, float layer, float refDepth)
+{
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+#if SHADOW_KERNEL == 1
+    return texture(shadowMap, vec4(uv, layer, refDepth));
+#elif SHADOW_KERNEL == 2
+    float lit = 0.0;
+    for (int x = 0; x < 2; ++x)
+    for (int y = 0; y < 2; ++y)
+        lit += texture(shadowMap, vec4(uv + (vec2(x, y) - 0.5) * texelSize, layer, refDepth));
+    return lit * 0.25;
+#else
+    // rotate the disk per pixel so the banding turns into noise
+    float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+    float lit = 0.0;
+    for (int i = 0; i < 8; ++i)
+        lit += texture(shadowMap, vec4(uv + rotation * poissonDisk[i] * 1.5 * texelSize, layer, refDepth));
+    return lit * 0.125;
+#endif
+}
+
+// Pick the first cascade that covers this fragment, -1 past the last split
+int SelectCascade()
+{
+    for (int i = 0; i < cascadeCount; ++i)
+        if (ViewDepth < cascadeSplits[i]) return i;
+    return -1;
+}
+
+// Shadow test with the selected kernel
+float ShadowCalculation(int light, int cascade, vec3 normal, vec3 lightDir)
+{
+#if SHADOW_KERNEL == 0
+    return 0.0;
+#else
+    if (cascade < 0) return 0.0;
+
+    // perspective divide
+    int layer = light * cascadeCount + cascade;
+    vec4 fragPosLightSpace = lightSpaceMatrices[layer] * vec4(FragPos, 1.0);
+    vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
+
+    // outside the light's frustum -> no shadow
+    if (projCoords.z > 1.0) return 0.0;
+
+    // to [0,1]
+    projCoords = projCoords * 0.5 + 0.5;
+
+    // far cascades cover more world per texel, so they need more bias
+    float bias = biasFromNormal(normal, lightDir) * (1.0 + float(cascade));
+
+    // PCF
+    return 1.0 - FilterShadow(projCoords.xy, float(layer), projCoords.z - bias);
+#endif
+}
+
+// Same lighting as Phong.frag, the specular strength is in the albedo alpha
+vec3 CalcLight(vec3 lightPos, int light, int cascade, vec3 n, float specularStrength)
+{
+    vec3 ambient  = vec3(0.2);
+    vec3 lightCol = vec3(1.0);
+
+    vec3 L = normalize(lightPos - FragPos);
+    float diff = max(dot(n, L), 0.0);
+    vec3 diffuse  = diff * lightCol;
+
+    vec3 V = normalize(viewPos - FragPos);
+    vec3 R = reflect(-L, n);
+    float spec = pow(max(dot(V, R), 0.0), 32.0);
+    vec3 specular = specularStrength * spec * lightCol;
+
+    float shadow = ShadowCalculation(light, cascade, n, L);
+
+    return ambient + (1.0 - shadow) * (diffuse + specular);
+}
+
+void main()
+{
+    float depth = texture(gDepth, TexCoord).r;
+    // the depth goes to the default framebuffer too, the sky and the queries test against it
+    gl_FragDepth = depth;
+    if (depth >= 1.0) {
+        FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+        return;
+    }
+
+    vec4 world = inverseViewProjection * vec4(vec3(TexCoord, depth) * 2.0 - 1.0, 1.0);
+    FragPos = world.xyz / world.w;
+    ViewDepth = -(view * vec4(FragPos, 1.0)).z;
+
+    vec4 albedo = texture(gAlbedo, TexCoord);
+    vec3 n = normalize(texture(gNormal, TexCoord).xyz);
+    int cascade = SelectCascade();
+    vec3 lighting = CalcLight(lightPos1, 0, cascade, n, albedo.a) + CalcLight(lightPos2, 1, cascade, n, albedo.a);
+    FragColor = vec4(lighting * albedo.rgb, 1.0);
+}
@@ -0,0 +1,11 @@
+#version 330 core
+
+// Full screen triangle from gl_VertexID, no vertex buffer
+out vec2 TexCoord;
+
+void main()
+{
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    TexCoord = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
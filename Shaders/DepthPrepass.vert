@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec4 aInstance; // towers only: xyz = position, w = height
+
+uniform mat4 worldMatrix;
+uniform mat4 view;
+uniform mat4 projection;
+uniform bool useInstancing = false;
+
+// Same math as Phong.vert so the lighting pass can test with GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+    mat4 world = worldMatrix;
+    if (useInstancing) {
+        world = mat4(vec4(2.0, 0.0, 0.0, 0.0),
+                     vec4(0.0, aInstance.w, 0.0, 0.0),
+                     vec4(0.0, 0.0, 2.0, 0.0),
+                     vec4(aInstance.xyz, 1.0));
+    }
+
+    vec3 fragPos = vec3(world * vec4(aPos, 1.0));
+    gl_Position = projection * (view * vec4(fragPos, 1.0));
+}
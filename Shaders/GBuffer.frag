@@ -0,0 +1,23 @@
+#version 330 core
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoord;
+
+uniform sampler2D textureSampler;
+uniform vec3 overrideColor = vec3(1.0);
+uniform float specularStrength = 1.0;
+
+// G-buffer: albedo + specular strength, world normal (depth comes from the depth attachment)
+layout (location = 0) out vec4 gAlbedo;
+layout (location = 1) out vec4 gNormal;
+
+void main()
+{
+    vec3 textureColor = texture(textureSampler, TexCoord).rgb;
+    vec3 finalColor = textureColor;
+    if (overrideColor != vec3(1.0)) {
+        finalColor = mix(textureColor, overrideColor, 0.5);
+    }
+    gAlbedo = vec4(finalColor, specularStrength);
+    gNormal = vec4(normalize(Normal), 0.0);
+}
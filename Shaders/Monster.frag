@@ -3,7 +3,7 @@
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoord;
-in vec4 FragPosLightSpace;
+in float ViewDepth;
 
 out vec4 FragColor;
 
@@ -11,7 +11,11 @@ uniform vec3 lightPos1;
 uniform vec3 lightPos2;
 uniform vec3 viewPos;
 
-uniform sampler2D shadowMap;
+// Cascaded shadow maps of both lights, layer = light * cascadeCount + cascade
+uniform sampler2DArrayShadow shadowMap;   // compares on lookup, every tap is a 2x2 PCF
+uniform mat4 lightSpaceMatrices[8];
+uniform float cascadeSplits[4];   // far view depth of each cascade
+uniform int cascadeCount;
 uniform sampler2D textureSampler;
 
 // normal-based bias to reduce acne
@@ -21,10 +25,61 @@ float biasFromNormal(vec3 n, vec3 lightDir)
 }
 
 
-// 3x3 PCF shadow test
-float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
+// Shadow filtering kernel, set by the program as a compile-time variant:
+// 0 = no shadows, 1 = one bilinear tap, 2 = 4 taps, 3 = rotated Poisson disk
+#ifndef SHADOW_KERNEL
+#define SHADOW_KERNEL 2
+#endif
+
+const vec2 poissonDisk[8] = vec2[](
+    vec2(-0.613392, 0.617481), vec2(0.170019, -0.040254),
+    vec2(-0.299417, 0.791925), vec2(0.645680, 0.493210),
+    vec2(-0.651784, 0.717887), vec2(0.421003, 0.027070),
+    vec2(-0.817194, -0.271096), vec2(-0.705374, -0.668203)
+);
+
+// Fraction of the kernel that is lit, each tap compares refDepth in hardware
+float FilterShadow(vec2 uv, float layer, float refDepth)
+{
+    vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+#if SHADOW_KERNEL == 1
+    return texture(shadowMap, vec4(uv, layer, refDepth));
+#elif SHADOW_KERNEL == 2
+    float lit = 0.0;
+    for (int x = 0; x < 2; ++x)
+    for (int y = 0; y < 2; ++y)
+        lit += texture(shadowMap, vec4(uv + (vec2(x, y) - 0.5) * texelSize, layer, refDepth));
+    return lit * 0.25;
+#else
+    // rotate the disk per pixel so the banding turns into noise
+    float angle = 6.2831853 * fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715))));
+    mat2 rotation = mat2(cos(angle), sin(angle), -sin(angle), cos(angle));
+    float lit = 0.0;
+    for (int i = 0; i < 8; ++i)
+        lit += texture(shadowMap, vec4(uv + rotation * poissonDisk[i] * 1.5 * texelSize, layer, refDepth));
+    return lit * 0.125;
+#endif
+}
+
+// Pick the first cascade that covers this fragment, -1 past the last split
+int SelectCascade()
 {
+    for (int i = 0; i < cascadeCount; ++i)
+        if (ViewDepth < cascadeSplits[i]) return i;
+    return -1;
+}
+
+// Shadow test with the selected kernel
+float ShadowCalculation(int light, int cascade, vec3 normal, vec3 lightDir)
+{
+#if SHADOW_KERNEL == 0
+    return 0.0;
+#else
+    if (cascade < 0) return 0.0;
+
     // perspective divide
+    int layer = light * cascadeCount + cascade;
+    vec4 fragPosLightSpace = lightSpaceMatrices[layer] * vec4(FragPos, 1.0);
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
 
     // outside light frustum -> no shadow
@@ -33,20 +88,54 @@ float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
     // to [0,1]
     projCoords = projCoords * 0.5 + 0.5;
 
-    float bias = biasFromNormal(normal, lightDir);
+    float bias = biasFromNormal(normal, lightDir) * (1.0 + float(cascade));
 
-    float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-    for (int x = -1; x <= 1; ++x)
-    for (int y = -1; y <= 1; ++y)
-    {
-        float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r;
-        shadow += (projCoords.z - bias > pcfDepth) ? 1.0 : 0.0;
-    }
-    shadow /= 9.0;
+    return 1.0 - FilterShadow(projCoords.xy, float(layer), projCoords.z - bias);
+#endif
+}
+
+#ifdef CLUSTERED_LIGHTING
+// Point lights of the clustered path (clustered.h), same falloff as the deferred light volumes
+uniform samplerBuffer clusterLights;     // 2 texels per light: position + radius, color + intensity
+uniform usamplerBuffer clusterRecords;   // per cluster: offset + count in clusterIndices
+uniform usamplerBuffer clusterIndices;   // light indices grouped by cluster
+uniform vec2 clusterScreenSize;
+uniform float clusterSplit;   // view depth where the logarithmic slices start
+uniform float clusterScale;   // slices per log unit of depth past clusterSplit
+
+int ClusterIndex()
+{
+    ivec2 tile = ivec2(gl_FragCoord.xy / clusterScreenSize * vec2(CLUSTER_X, CLUSTER_Y));
+    tile = clamp(tile, ivec2(0), ivec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+    int slice = ViewDepth < clusterSplit ? 0 : 1 + int(log(ViewDepth / clusterSplit) * clusterScale);
+    slice = clamp(slice, 0, CLUSTER_Z - 1);
+    return (slice * CLUSTER_Y + tile.y) * CLUSTER_X + tile.x;
+}
 
-    return clamp(shadow, 0.0, 1.0);
+vec3 ClusteredPointLights(vec3 n, vec3 V, float specularStrength)
+{
+    uvec2 record = texelFetch(clusterRecords, ClusterIndex()).xy;
+    vec3 result = vec3(0.0);
+    for (uint i = 0u; i < record.y; ++i) {
+        int light = int(texelFetch(clusterIndices, int(record.x + i)).r);
+        vec4 positionRadius = texelFetch(clusterLights, 2 * light);
+        vec4 colorIntensity = texelFetch(clusterLights, 2 * light + 1);
+
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float distance = length(toLight);
+        if (distance >= positionRadius.w) continue;
+        // inverse square with a window so the light reaches exactly 0 at the radius
+        float window = clamp(1.0 - pow(distance / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (1.0 + distance * distance);
+
+        vec3 L = toLight / distance;
+        float diff = max(dot(n, L), 0.0);
+        float spec = specularStrength * pow(max(dot(V, reflect(-L, n)), 0.0), 32.0);
+        result += colorIntensity.rgb * colorIntensity.a * attenuation * (diff + spec);
+    }
+    return result;
 }
+#endif
 
 void main()
 {
@@ -55,6 +144,8 @@ void main()
     vec3 n = normalize(Normal);
     vec3 V = normalize(viewPos - FragPos);
 
+    int cascade = SelectCascade();
+
     vec3 result = vec3(0.0);
     for (int i = 0; i < 2; ++i)
     {
@@ -69,9 +160,12 @@ void main()
         float spec    = pow(max(dot(V, R), 0.0), 32.0);
         vec3 specular = 0.5 * spec * vec3(1.0);
 
-        float shadow  = ShadowCalculation(FragPosLightSpace, n, L);
+        float shadow  = ShadowCalculation(i, cascade, n, L);
         result += ambient + (1.0 - shadow) * (diffuse + specular);
     }
+#ifdef CLUSTERED_LIGHTING
+    result += ClusteredPointLights(n, V, 0.5) * albedo;
+#endif
 
     FragColor = vec4(result, 1.0);
 }
@@ -3,24 +3,33 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 texCoords;
+layout (location = 3) in vec4 aInstance;   // instanced monsters: xyz = position, w = scale
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
-out vec4 FragPosLightSpace;
+out float ViewDepth;   // distance along the view direction, picks the shadow cascade
 
 uniform mat4 worldMatrix;
 uniform mat4 view = mat4(1.0f);
 uniform mat4 projection = mat4(1.0f);
-uniform mat4 lightSpaceMatrix;
+uniform bool useInstancing = false;
 
 void main()
 {
-    vec4 worldPosition = worldMatrix * vec4(aPos, 1.0);
+    vec4 worldPosition;
+    if (useInstancing) {
+        // uniform scale + translation, the normal is unchanged
+        worldPosition = vec4(aPos * aInstance.w + aInstance.xyz, 1.0);
+        Normal = aNormal;
+    } else {
+        worldPosition = worldMatrix * vec4(aPos, 1.0);
+        Normal = mat3(transpose(inverse(worldMatrix))) * aNormal;
+    }
     FragPos = vec3(worldPosition);
-    Normal = mat3(transpose(inverse(worldMatrix))) * aNormal;
     TexCoord = texCoords;
-    FragPosLightSpace = lightSpaceMatrix * worldPosition;
+    vec4 viewPosition = view * worldPosition;
+    ViewDepth = -viewPosition.z;
 
-    gl_Position = projection * view * worldPosition;
+    gl_Position = projection * viewPosition;
 }
@@ -2,23 +2,53 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in vec4 aInstance; // towers: xyz = position, w = height / projectiles: xyz = position, w = length
+layout (location = 4) in vec4 aDirection; // projectiles only: xyz = unit direction, w = width
 
 uniform mat4 worldMatrix;
 uniform mat4 view;
 uniform mat4 projection;
-uniform mat4 lightSpaceMatrix;
+uniform bool useInstancing = false;
+uniform bool useProjectileInstancing = false;
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoord;
-out vec4 FragPosLightSpace;
+out float ViewDepth;   // distance along the view direction, picks the shadow cascade
+
+// matches DepthPrepass.vert bit for bit, the scene is tested with GL_EQUAL after the pre-pass
+invariant gl_Position;
+
+// Projectile beam: the unit cube scaled to width x width x length and turned along the direction
+mat4 ProjectileWorld()
+{
+    vec3 dir = aDirection.xyz;
+    vec3 up = abs(dir.y) > 0.99 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(up, dir));
+    vec3 newUp = cross(dir, right);
+    return mat4(vec4(right * aDirection.w, 0.0),
+                vec4(newUp * aDirection.w, 0.0),
+                vec4(dir * aInstance.w, 0.0),
+                vec4(aInstance.xyz, 1.0));
+}
 
 void main()
 {
-    FragPos = vec3(worldMatrix * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(worldMatrix))) * aNormal;
+    mat4 world = worldMatrix;
+    if (useInstancing) {
+        // same as translate(position) * scale(2, height, 2) on the CPU
+        world = mat4(vec4(2.0, 0.0, 0.0, 0.0),
+                     vec4(0.0, aInstance.w, 0.0, 0.0),
+                     vec4(0.0, 0.0, 2.0, 0.0),
+                     vec4(aInstance.xyz, 1.0));
+    }
+    if (useProjectileInstancing) world = ProjectileWorld();
+
+    FragPos = vec3(world * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(world))) * aNormal;
     TexCoord = aTexCoord;
 
-    FragPosLightSpace = lightSpaceMatrix * vec4(FragPos, 1.0);
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    vec4 viewPosition = view * vec4(FragPos, 1.0);
+    ViewDepth = -viewPosition.z;
+    gl_Position = projection * viewPosition;
 }
@@ -0,0 +1,41 @@
+#version 330 core
+flat in vec4 LightPositionRadius;
+flat in vec4 LightColor;
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+uniform vec3 viewPos;
+uniform vec2 screenSize;
+
+out vec4 FragColor;
+
+// One point light over the G-buffer, added to what is already in the framebuffer
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / screenSize;
+    float depth = texture(gDepth, uv).r;
+    if (depth >= 1.0) discard;
+
+    vec4 world = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+    vec3 fragPos = world.xyz / world.w;
+
+    vec3 toLight = LightPositionRadius.xyz - fragPos;
+    float distance = length(toLight);
+    float radius = LightPositionRadius.w;
+    if (distance >= radius) discard;
+
+    // inverse square with a window so the light reaches exactly 0 at the radius
+    float window = clamp(1.0 - pow(distance / radius, 4.0), 0.0, 1.0);
+    float attenuation = window * window / (1.0 + distance * distance);
+
+    vec4 albedo = texture(gAlbedo, uv);
+    vec3 n = normalize(texture(gNormal, uv).xyz);
+    vec3 L = toLight / distance;
+    float diff = max(dot(n, L), 0.0);
+    vec3 V = normalize(viewPos - fragPos);
+    float spec = albedo.a * pow(max(dot(V, reflect(-L, n)), 0.0), 32.0);
+
+    FragColor = vec4(LightColor.rgb * LightColor.a * attenuation * (diff + spec) * albedo.rgb, 1.0);
+}
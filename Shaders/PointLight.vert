@@ -0,0 +1,18 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;     // unit cube
+layout (location = 3) in vec4 aLight;   // xyz = position, w = radius
+layout (location = 4) in vec4 aColor;   // rgb = color, a = intensity
+
+uniform mat4 view;
+uniform mat4 projection;
+
+flat out vec4 LightPositionRadius;
+flat out vec4 LightColor;
+
+void main()
+{
+    LightPositionRadius = aLight;
+    LightColor = aColor;
+    // the cube encloses the light's sphere
+    gl_Position = projection * view * vec4(aLight.xyz + aPos * 2.0 * aLight.w, 1.0);
+}
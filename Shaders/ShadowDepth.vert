@@ -1,10 +1,19 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec4 aInstance; // towers only: xyz = position, w = height
 
 uniform mat4 worldMatrix;
 uniform mat4 lightSpaceMatrix;
+uniform bool useInstancing = false;
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * worldMatrix * vec4(aPos, 1.0);
+    mat4 world = worldMatrix;
+    if (useInstancing) {
+        world = mat4(vec4(2.0, 0.0, 0.0, 0.0),
+                     vec4(0.0, aInstance.w, 0.0, 0.0),
+                     vec4(0.0, 0.0, 2.0, 0.0),
+                     vec4(aInstance.xyz, 1.0));
+    }
+    gl_Position = lightSpaceMatrix * world * vec4(aPos, 1.0);
 }
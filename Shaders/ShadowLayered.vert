@@ -0,0 +1,60 @@
+#version 330 core
+#extension GL_ARB_shader_viewport_layer_array : enable
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in vec4 aInstance; // towers: xyz = position, w = height / projectiles: xyz = position, w = length / monsters: xyz = position, w = scale
+layout (location = 4) in vec4 aDirection; // projectiles only: xyz = unit direction, w = width
+layout (location = 5) in int aLayerSlot;  // (caster, layer) pair streams: which of this pass's layers the instance goes to
+
+uniform mat4 worldMatrix;
+uniform mat4 layerMatrices[8];  // light space matrix of each layer drawn by this pass
+uniform int layerIndex[8];      // and which layer of the shadow array it is
+uniform int layerCount;         // repeated draws: instances per caster
+uniform int drawSlots[8];       // repeated draws: the layer slot of each of them
+uniform bool useLayerSlots = false;
+uniform bool useInstancing = false;
+uniform bool useProjectileInstancing = false;
+uniform bool useMonsterInstancing = false;
+
+flat out int vLayer;
+
+// Projectile beam: the unit cube scaled to width x width x length and turned along the direction
+mat4 ProjectileWorld()
+{
+    vec3 dir = aDirection.xyz;
+    vec3 up = abs(dir.y) > 0.99 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(up, dir));
+    vec3 newUp = cross(dir, right);
+    return mat4(vec4(right * aDirection.w, 0.0),
+                vec4(newUp * aDirection.w, 0.0),
+                vec4(dir * aInstance.w, 0.0),
+                vec4(aInstance.xyz, 1.0));
+}
+
+void main()
+{
+    // Pair streams carry the slot of every instance. Other draws repeat each
+    // caster layerCount times (its attributes advance every layerCount
+    // instances) and drawSlots tells which layers the repeats go to.
+    int slot = useLayerSlots ? aLayerSlot : drawSlots[gl_InstanceID % layerCount];
+
+    mat4 world = worldMatrix;
+    if (useInstancing) {
+        world = mat4(vec4(2.0, 0.0, 0.0, 0.0),
+                     vec4(0.0, aInstance.w, 0.0, 0.0),
+                     vec4(0.0, 0.0, 2.0, 0.0),
+                     vec4(aInstance.xyz, 1.0));
+    }
+    if (useProjectileInstancing) world = ProjectileWorld();
+    if (useMonsterInstancing) {
+        world = mat4(vec4(aInstance.w, 0.0, 0.0, 0.0),
+                     vec4(0.0, aInstance.w, 0.0, 0.0),
+                     vec4(0.0, 0.0, aInstance.w, 0.0),
+                     vec4(aInstance.xyz, 1.0));
+    }
+    vLayer = layerIndex[slot];
+    gl_Position = layerMatrices[slot] * world * vec4(aPos, 1.0);
+#ifdef GL_ARB_shader_viewport_layer_array
+    // no geometry shader needed when the vertex shader can pick the layer
+    gl_Layer = vLayer;
+#endif
+}
@@ -0,0 +1,15 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 view;        // rotation only
+uniform mat4 projection;
+
+out vec3 TexDir;
+
+void main()
+{
+    TexDir = aPos;
+    vec4 position = projection * view * vec4(aPos, 1.0);
+    // z = w puts the sky on the far plane, depth 1.0 after the divide
+    gl_Position = position.xyww;
+}
@@ -0,0 +1,929 @@
+#pragma once
+
+// CPU-side benchmarks, run with: Project371 --bench <name>
+// They do not need a window or an OpenGL context, except for the GPU
+// benchmarks at the end that run inside the game loop.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <list>
+#include <queue>
+#include <initializer_list>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "clustered.h"
+#include "fixedstep.h"
+#include "flowfield.h"
+#include "frustum.h"
+#include "jobs.h"
+#include "lights.h"
+#include "monsters.h"
+#include "occlusion.h"
+#include "projectile.h"
+#include "shadows.h"
+#include "simulation.h"
+#include "spatialgrid.h"
+#include "towers.h"
+
+// Milliseconds taken by the best of `repeats` runs of fn
+// ------------------------------------------------------
+template <typename Fn>
+double benchmarkBestOf(int repeats, Fn&& fn) {
+    double best = 1e30;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::high_resolution_clock::now();
+        fn();
+        auto end = std::chrono::high_resolution_clock::now();
+        best = std::min(best, std::chrono::duration<double, std::milli>(end - start).count());
+    }
+    return best;
+}
+
+// Frustum culling of 1M random boxes with every kernel
+// ----------------------------------------------------
+inline void benchmarkFrustumCulling() {
+    const size_t boxCount = 1000000;
+    std::mt19937 rng(371);
+    std::uniform_real_distribution<float> position(-1000.0f, 1000.0f);
+    std::uniform_real_distribution<float> height(5.0f, 25.0f);
+
+    AABBList boxes;
+    boxes.reserve(boxCount);
+    for (size_t i = 0; i < boxCount; ++i) {
+        float h = height(rng);
+        boxes.push(glm::vec3(position(rng), 0.0f, position(rng)), glm::vec3(1.0f, 0.5f * h, 1.0f));
+    }
+
+    // Same projection as the game, standing at the center looking down -Z
+    glm::mat4 projection = glm::perspective(glm::radians(70.0f), 1024.0f / 768.0f, 0.03f, 800.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.0f, 10.0f), glm::vec3(0.0f, 1.0f, 9.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    std::cout << "BENCH: frustum culling, " << boxCount << " boxes (best of 10)" << std::endl;
+    std::vector<uint32_t> reference, visible;
+    cullAABBs(frustum, boxes, reference, CullKernel::Scalar);
+    for (CullKernel kernel : { CullKernel::Scalar, CullKernel::SSE, CullKernel::AVX2 }) {
+        double ms = benchmarkBestOf(10, [&] { cullAABBs(frustum, boxes, visible, kernel); });
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  " << std::setw(6) << cullKernelName(kernel) << ": " << ms << " ms, "
+                  << boxCount / (ms * 1000.0) << " Mboxes/s, visible " << visible.size()
+                  << (visible == reference ? "" : "  (MISMATCH with scalar)") << std::endl;
+    }
+}
+
+// Frustum + software occlusion culling of generated cities seen from street level
+// -------------------------------------------------------------------------------
+inline void benchmarkOcclusionCulling() {
+    glm::mat4 projection = glm::perspective(glm::radians(70.0f), 1024.0f / 768.0f, 0.03f, 800.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.6f, 1.0f, 10.0f), glm::vec3(0.6f, 1.0f, 9.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProjection = projection * view;
+    Frustum frustum = Frustum::fromMatrix(viewProjection);
+
+    std::cout << "BENCH: software occlusion culling from the default camera, " << workerCount() << " threads (best of 20)" << std::endl;
+    for (int towerCount : { 100, 1000, 10000, 100000 }) {
+        std::vector<Tower> towers;
+        srand(371);
+        generateTowers(towerCount, towers);
+        AABBList boxes;
+        boxes.reserve(towers.size());
+        for (const auto& tower : towers) boxes.push(tower.position, towerExtent(tower));
+
+        std::vector<uint32_t> inFrustum, visible;
+        cullAABBs(frustum, boxes, inFrustum);
+        SoftwareOcclusion occlusion;
+        double ms = benchmarkBestOf(20, [&] {
+            visible = inFrustum;
+            occlusion.cull(viewProjection, boxes, visible);
+        });
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  " << std::setw(6) << towers.size() << " towers: in frustum " << inFrustum.size()
+                  << ", after occlusion " << visible.size()
+                  << " (" << 100.0 * (inFrustum.size() - visible.size()) / std::max<size_t>(1, inFrustum.size()) << "% culled), "
+                  << ms << " ms" << std::endl;
+    }
+}
+
+// Shadow caster collection for every layer (both lights x cascades): light frustum
+// only vs light frustum + receiver extrusion, with the lights at their starting
+// points of the orbit. The layered pass draws one (tower, layer) pair per caster.
+// -------------------------------------------------------------------------------
+inline void benchmarkShadowCasters() {
+    glm::mat4 view = glm::lookAt(glm::vec3(0.6f, 1.0f, 10.0f), glm::vec3(0.6f, 1.0f, 9.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    CascadedShadowMap cascades;
+    cascades.staticCache = false;
+    const glm::vec3 lightDirs[MAX_SHADOW_LIGHTS] = { glm::normalize(-glm::vec3(10.0f, 5.0f, 0.0f)),
+                                                     glm::normalize(-glm::vec3(std::cos(3.14f) * 10.0f, 5.0f, std::sin(3.14f) * 10.0f)) };
+    const int lightSteps[MAX_SHADOW_LIGHTS] = { 0, 0 };
+    cascades.update(view, glm::radians(70.0f), 1024.0f / 768.0f, 0.03f, 800.0f, lightDirs, lightSteps);
+    const int layers = cascades.layerCount();
+
+    std::cout << "BENCH: shadow caster culling over " << layers << " layers (" << cascades.lightCount << " lights x "
+              << cascades.cascadeCount << " cascades, best of 20)" << std::endl;
+    for (int towerCount : { 100, 10000 }) {
+        std::vector<Tower> towers;
+        srand(371);
+        generateTowers(towerCount, towers);
+        AABBList boxes;
+        boxes.reserve(towers.size());
+        for (const auto& tower : towers) boxes.push(tower.position, towerExtent(tower));
+
+        std::vector<uint32_t> casters[MAX_SHADOW_LAYERS];
+        size_t inLightFrustum = 0, afterReceivers = 0;
+        double frustumMs = benchmarkBestOf(20, [&] {
+            for (int l = 0; l < layers; ++l) cullAABBs(cascades.frustum(l), boxes, casters[l]);
+        });
+        for (int l = 0; l < layers; ++l) inLightFrustum += casters[l].size();
+        double totalMs = benchmarkBestOf(20, [&] {
+            afterReceivers = 0;
+            for (int l = 0; l < layers; ++l) {
+                cullAABBs(cascades.frustum(l), boxes, casters[l]);
+                cullShadowCasters(cascades.receiverFrustum(l), boxes, cascades.lightDirection(l / cascades.cascadeCount), -1.0f,
+                                  cascades.maxShadowLength, casters[l]);
+                afterReceivers += casters[l].size();
+            }
+        });
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  " << std::setw(6) << towers.size() << " towers: " << towers.size() * layers << " unculled draws, "
+                  << inLightFrustum << " in light frustums (" << frustumMs << " ms), "
+                  << afterReceivers << " after receiver extrusion (" << totalMs << " ms)" << std::endl;
+    }
+}
+
+// Static shadow cache: 10 simulated seconds at 60 fps, walking forward while
+// turning, the light orbits at 1 rad/s like in the game. Counts how many
+// layers and tower draws (tower x layer instances) the shadow pass needs per
+// frame with and without the cache (the dynamic casters are drawn every frame
+// in both cases).
+// ---------------------------------------------------------------------------
+inline void benchmarkShadowCache() {
+    std::cout << "BENCH: static shadow cache, 600 frames at 60 fps, walking + turning camera" << std::endl;
+    for (int towerCount : { 100, 10000 }) {
+        std::vector<Tower> towers;
+        srand(371);
+        generateTowers(towerCount, towers);
+        AABBList boxes;
+        boxes.reserve(towers.size());
+        for (const auto& tower : towers) boxes.push(tower.position, towerExtent(tower));
+
+        for (int steps : { 0, 16, 32, 64 }) {   // 0 = cache off
+            bool cache = steps > 0;
+            CascadedShadowMap cascades;
+            cascades.staticCache = cache;
+            cascades.lightAngleSteps = std::max(steps, 1);
+            std::vector<uint32_t> casters[MAX_SHADOW_LAYERS];
+            size_t layersDrawn = 0, towerDraws = 0;
+            const int frames = 600;
+            double ms = benchmarkBestOf(1, [&] {
+                for (int frame = 0; frame < frames; ++frame) {
+                    float time = frame / 60.0f;
+                    float yaw = 0.3f * time;
+                    glm::vec3 eye(0.6f + 2.0f * time, 1.0f, 10.0f - 1.0f * time);
+                    glm::mat4 view = glm::lookAt(eye, eye + glm::vec3(std::sin(yaw), 0.0f, -std::cos(yaw)), glm::vec3(0.0f, 1.0f, 0.0f));
+
+                    glm::vec3 lightDirs[MAX_SHADOW_LIGHTS];
+                    int lightSteps[MAX_SHADOW_LIGHTS];
+                    for (int light = 0; light < cascades.lightCount; ++light) {
+                        float orbit = time + 3.14f * light;
+                        lightSteps[light] = cascades.quantizeLightAngle(orbit);
+                        float angle = cache ? cascades.lightStepAngle(lightSteps[light]) : orbit;
+                        lightDirs[light] = glm::normalize(-glm::vec3(std::cos(angle) * 10.0f, 5.0f, std::sin(angle) * 10.0f));
+                    }
+                    cascades.update(view, glm::radians(70.0f), 1024.0f / 768.0f, 0.03f, 800.0f, lightDirs, lightSteps);
+
+                    int drawn = 0;
+                    for (int l = 0; l < cascades.layerCount(); ++l) {
+                        if (!cascades.needsStaticPass(l)) continue;
+                        cullAABBs(cascades.frustum(l), boxes, casters[drawn]);
+                        cullShadowCasters(cascades.receiverFrustum(l), boxes, cascades.lightDirection(l / cascades.cascadeCount), -1.0f,
+                                          cascades.maxShadowLength, casters[drawn]);
+                        towerDraws += casters[drawn].size();   // one (tower, layer) pair each
+                        ++drawn;
+                    }
+                    layersDrawn += drawn;
+                }
+            });
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  " << std::setw(6) << towers.size() << " towers, " << (cache ? std::to_string(steps) + " light steps" : "cache off     ") << ": "
+                      << double(layersDrawn) / frames << " static layers/frame, "
+                      << double(towerDraws) / frames << " tower draws/frame, "
+                      << ms / frames << " ms/frame CPU" << std::endl;
+        }
+    }
+}
+
+// Clustered light lists: point lights scattered around a camera standing in
+// the city, assigned to the 16 x 9 x 24 clusters on one thread and on every
+// worker thread. Reports the list size and the busiest cluster as well.
+// ---------------------------------------------------------------------------
+inline void benchmarkClusters() {
+    std::cout << "BENCH: clustered light lists, " << CLUSTER_X << "x" << CLUSTER_Y << "x" << CLUSTER_Z
+              << " clusters, " << workerCount() << " worker threads" << std::endl;
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 1.5f, 40.0f), glm::vec3(0.0f, 1.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(70.0f), 1024.0f / 768.0f, 0.03f, 800.0f);
+    for (int count : { 100, 1000, 4000 }) {
+        std::vector<PointLight> lights;
+        srand(371);
+        generateRandomLights(count, 50.0f, lights);
+        ClusteredLights clusters;
+        for (bool threaded : { false, true }) {
+            clusters.multithreaded = threaded;
+            double ms = benchmarkBestOf(20, [&] { clusters.build(view, projection, 0.03f, 800.0f, lights); });
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  " << std::setw(5) << count << " lights, " << (threaded ? "threaded" : "1 thread") << ": "
+                      << ms << " ms, " << clusters.indexCount() << " indices, "
+                      << clusters.maxClusterLights() << " lights in the busiest cluster" << std::endl;
+        }
+    }
+}
+
+// Projectile update + cull: the old std::list of projectiles (one heap node
+// each, erase while iterating) vs the structure of arrays pool with every
+// simulation kernel (scalar, SSE 4 wide, AVX2 8 wide). 60 frames at
+// 60 fps of projectiles flying out from random spots, against a monster
+// sphere at the origin, most of them leave the 800 unit range on the way.
+// ---------------------------------------------------------------------------
+inline void benchmarkProjectiles() {
+    struct ListProjectile { glm::vec3 position, prevPosition, velocity; };
+    std::cout << "BENCH: projectile update + cull, 60 frames at 60 fps" << std::endl;
+    const int frames = 60;
+    const float dt = 1.0f / 60.0f;
+    const glm::vec3 target(0.0f);
+    const float radius = 1.0f;
+    for (size_t count : { size_t(1000), size_t(100000), size_t(1000000) }) {
+        std::mt19937 rng(371);
+        std::uniform_real_distribution<float> spot(-800.0f, 800.0f), dir(-1.0f, 1.0f);
+        std::vector<glm::vec3> positions(count), velocities(count);
+        for (size_t i = 0; i < count; ++i) {
+            positions[i] = glm::vec3(spot(rng), spot(rng) * 0.01f, spot(rng));
+            velocities[i] = glm::normalize(glm::vec3(dir(rng), dir(rng), dir(rng)) + glm::vec3(0.0f, 0.0f, 1e-3f)) * 25.0f;
+        }
+
+        // Walk the nodes in shuffled memory order, like a list that has been
+        // spawning and erasing for a while
+        std::list<ListProjectile> list, allocated;
+        for (size_t i = 0; i < count; ++i) allocated.push_back({ positions[i], positions[i], velocities[i] });
+        std::vector<std::list<ListProjectile>::iterator> nodes;
+        for (auto it = allocated.begin(); it != allocated.end(); ++it) nodes.push_back(it);
+        std::shuffle(nodes.begin(), nodes.end(), rng);
+        for (auto node : nodes) list.splice(list.end(), allocated, node);
+        size_t listHits = 0;
+        double listMs = benchmarkBestOf(1, [&] {
+            for (int frame = 0; frame < frames; ++frame)
+                for (auto it = list.begin(); it != list.end();) {
+                    it->prevPosition = it->position;
+                    it->position += it->velocity * dt;
+                    if (segmentHitsSphere(it->prevPosition, it->position, target, radius)) { ++listHits; it = list.erase(it); continue; }
+                    if (glm::dot(it->position, it->position) > PROJECTILE_MAX_DISTANCE * PROJECTILE_MAX_DISTANCE) { it = list.erase(it); continue; }
+                    ++it;
+                }
+        });
+
+        struct PoolRun { CullKernel kernel; double ms; size_t left, hits; };
+        std::vector<PoolRun> runs;
+        for (CullKernel kernel : { CullKernel::Scalar, CullKernel::SSE, CullKernel::AVX2 }) {
+            ProjectilePool pool(count);
+            for (size_t i = 0; i < count; ++i) pool.spawn(positions[i], velocities[i]);
+            size_t hits = 0;
+            double ms = benchmarkBestOf(1, [&] {
+                for (int frame = 0; frame < frames; ++frame) hits += pool.simulate(dt, target, radius, kernel);
+            });
+            runs.push_back({ kernel, ms, pool.size(), hits });
+        }
+
+        auto report = [&](const std::string& name, double ms, size_t left, size_t hits) {
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  " << std::setw(7) << count << " projectiles, " << std::left << std::setw(11) << name << std::right << ": "
+                      << ms / frames << " ms/frame, "
+                      << std::setprecision(1) << count * frames / (ms * 1000.0) << " M updates/s, "
+                      << left << " left, " << hits << " hits" << std::endl;
+        };
+        report("std::list", listMs, list.size(), listHits);
+        for (const auto& run : runs) report(std::string("pool ") + cullKernelName(run.kernel), run.ms, run.left, run.hits);
+    }
+}
+
+// Tower queries through the uniform grid vs testing every tower: spawn checks
+// (any tower footprint within 1.5 of a random point) and first hit along
+// random 10 unit segments, both spread over the whole city. The brute force
+// runs on the first queries only, the hit counts are compared on those.
+// ---------------------------------------------------------------------------
+inline void benchmarkSpatialGrid() {
+    const size_t queryCount = 1000000;
+    std::cout << "BENCH: tower queries, uniform grid (" << SPATIAL_GRID_CELL_SIZE << " unit cells) vs brute force, "
+              << queryCount << " queries" << std::endl;
+    for (int towerCount : { 100, 10000, 1000000 }) {
+        std::vector<Tower> towers;
+        srand(371);
+        float halfExtent = generateTowers(towerCount, towers);
+        AABBList boxes;
+        boxes.reserve(towers.size());
+        for (const auto& tower : towers) boxes.push(tower.position, towerExtent(tower));
+
+        SpatialGrid grid;
+        double buildMs = benchmarkBestOf(3, [&] { grid.build(boxes); });
+
+        std::mt19937 rng(371);
+        std::uniform_real_distribution<float> spot(-halfExtent, halfExtent), height(0.0f, 10.0f), dir(-1.0f, 1.0f);
+        std::vector<glm::vec3> starts(queryCount), ends(queryCount);
+        for (size_t i = 0; i < queryCount; ++i) {
+            starts[i] = glm::vec3(spot(rng), height(rng), spot(rng));
+            ends[i] = starts[i] + glm::normalize(glm::vec3(dir(rng), dir(rng) * 0.2f, dir(rng)) + glm::vec3(1e-3f)) * 10.0f;
+        }
+        size_t bruteCount = std::min(queryCount, std::max<size_t>(10, 100000000 / towers.size()));
+
+        // Spawn checks
+        std::vector<uint8_t> gridBlocked(queryCount), bruteBlocked(bruteCount);
+        double gridSpawnMs = benchmarkBestOf(3, [&] {
+            for (size_t i = 0; i < queryCount; ++i) gridBlocked[i] = grid.anyWithinRadius(starts[i].x, starts[i].z, 1.5f);
+        });
+        double bruteSpawnMs = benchmarkBestOf(1, [&] {
+            for (size_t i = 0; i < bruteCount; ++i) {
+                bruteBlocked[i] = 0;
+                for (size_t t = 0; t < boxes.size() && !bruteBlocked[i]; ++t) {
+                    float dx = std::max(std::abs(starts[i].x - boxes.centerX[t]) - boxes.extentX[t], 0.0f);
+                    float dz = std::max(std::abs(starts[i].z - boxes.centerZ[t]) - boxes.extentZ[t], 0.0f);
+                    bruteBlocked[i] = dx * dx + dz * dz < 1.5f * 1.5f;
+                }
+            }
+        });
+
+        // First hit along segments
+        std::vector<float> gridT(queryCount), bruteT(bruteCount);
+        double gridSegmentMs = benchmarkBestOf(3, [&] {
+            for (size_t i = 0; i < queryCount; ++i) {
+                uint32_t item;
+                if (!grid.segmentQuery(starts[i], ends[i], gridT[i], item)) gridT[i] = 2.0f;
+            }
+        });
+        double bruteSegmentMs = benchmarkBestOf(1, [&] {
+            for (size_t i = 0; i < bruteCount; ++i) {
+                bruteT[i] = 2.0f;
+                for (size_t t = 0; t < boxes.size(); ++t) {
+                    glm::vec3 center(boxes.centerX[t], boxes.centerY[t], boxes.centerZ[t]);
+                    glm::vec3 extent(boxes.extentX[t], boxes.extentY[t], boxes.extentZ[t]);
+                    float hit;
+                    if (segmentHitsAABB(starts[i], ends[i], center - extent, center + extent, hit)) bruteT[i] = std::min(bruteT[i], hit);
+                }
+            }
+        });
+
+        size_t spawnMismatches = 0, segmentMismatches = 0, segmentHits = 0;
+        for (size_t i = 0; i < bruteCount; ++i) {
+            spawnMismatches += gridBlocked[i] != bruteBlocked[i];
+            segmentMismatches += gridT[i] != bruteT[i];
+        }
+        for (size_t i = 0; i < queryCount; ++i) segmentHits += gridT[i] <= 1.0f;
+
+        auto rate = [](size_t count, double ms) { return count / (ms * 1000.0); };
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  " << std::setw(7) << towers.size() << " towers: build " << buildMs << " ms, "
+                  << grid.cellCount() << " cells, " << grid.entryCount() << " entries" << std::endl
+                  << std::setprecision(2)
+                  << "    spawn   : grid " << rate(queryCount, gridSpawnMs) << " M/s, brute force " << rate(bruteCount, bruteSpawnMs)
+                  << " M/s (" << rate(queryCount, gridSpawnMs) / rate(bruteCount, bruteSpawnMs) << "x)"
+                  << (spawnMismatches ? "  MISMATCH" : "") << std::endl
+                  << "    segment : grid " << rate(queryCount, gridSegmentMs) << " M/s, brute force " << rate(bruteCount, bruteSegmentMs)
+                  << " M/s (" << rate(queryCount, gridSegmentMs) / rate(bruteCount, bruteSegmentMs) << "x), "
+                  << 100.0 * segmentHits / queryCount << "% hit"
+                  << (segmentMismatches ? "  MISMATCH" : "") << std::endl;
+    }
+}
+
+// Projectiles stopped at the towers: 100k projectiles flying from random
+// street spots for 60 frames at 60 fps, without and with the grid walk of
+// their segments, in cities of 100, 10k and 1M towers. The walk only visits
+// the cells under each segment so its cost per projectile should not grow
+// with the city.
+// ---------------------------------------------------------------------------
+inline void benchmarkProjectileCollisions() {
+    const size_t count = 100000;
+    const int frames = 60;
+    const float dt = 1.0f / 60.0f;
+    const glm::vec3 target(0.0f, -100.0f, 0.0f);   // out of the way, only towers stop them
+    std::cout << "BENCH: projectiles vs towers, " << count << " projectiles, " << frames << " frames at 60 fps" << std::endl;
+    for (int towerCount : { 100, 10000, 1000000 }) {
+        std::vector<Tower> towers;
+        srand(371);
+        float halfExtent = generateTowers(towerCount, towers);
+        AABBList boxes;
+        boxes.reserve(towers.size());
+        for (const auto& tower : towers) boxes.push(tower.position, towerExtent(tower));
+        SpatialGrid grid;
+        grid.build(boxes);
+
+        std::mt19937 rng(371);
+        float spread = std::min(halfExtent, 0.7f * PROJECTILE_MAX_DISTANCE);   // none culled by range on the way
+        std::uniform_real_distribution<float> spot(-spread, spread), height(0.5f, 10.0f), dir(-1.0f, 1.0f);
+        std::vector<glm::vec3> positions, velocities;
+        while (positions.size() < count) {
+            glm::vec3 position(spot(rng), height(rng), spot(rng));
+            if (grid.anyWithinRadius(position.x, position.z, 0.1f)) continue;
+            positions.push_back(position);
+            velocities.push_back(glm::normalize(glm::vec3(dir(rng), dir(rng) * 0.2f, dir(rng)) + glm::vec3(1e-3f)) * 25.0f);
+        }
+
+        for (bool collide : { false, true }) {
+            ProjectilePool pool(count);
+            for (size_t i = 0; i < count; ++i) pool.spawn(positions[i], velocities[i]);
+            size_t updates = 0, stopped = 0;
+            double ms = benchmarkBestOf(1, [&] {
+                for (int frame = 0; frame < frames; ++frame) {
+                    updates += pool.size();
+                    pool.simulate(dt, target, 1.0f, bestCullKernel(), collide ? &grid : nullptr);
+                    stopped += pool.obstacleHits();
+                }
+            });
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  " << std::setw(7) << towers.size() << " towers, " << (collide ? "grid walk" : "no towers") << ": "
+                      << ms / frames << " ms/frame, " << std::setprecision(1) << 1e6 * ms / std::max<size_t>(1, updates) << " ns/projectile, "
+                      << stopped << " stopped, " << pool.size() << " left" << std::endl;
+        }
+    }
+}
+
+// Projectiles vs a wave of monsters: every segment tested against every
+// monster vs paired through the monster grid (rebuilt every frame, counted
+// in the time). 10k projectiles crossing the wave for 60 frames at 60 fps,
+// the monsters stand still and are not respawned so both see the same hits.
+// ---------------------------------------------------------------------------
+inline void benchmarkMonsters() {
+    const size_t count = 10000;
+    const int frames = 60;
+    const float dt = 1.0f / 60.0f;
+    std::cout << "BENCH: projectiles vs monsters, " << count << " projectiles, " << frames << " frames at 60 fps" << std::endl;
+    for (size_t monsterCount : { size_t(100), size_t(1000), MAX_MONSTERS }) {
+        std::mt19937 rng(371);
+        float spread = 22.0f + 2.0f * std::sqrt(static_cast<float>(monsterCount));
+        std::uniform_real_distribution<float> spot(-spread, spread), height(0.5f, 2.0f), dir(-1.0f, 1.0f);
+        MonsterPool monsters(monsterCount);
+        while (monsters.size() < monsterCount) monsters.spawn(glm::vec3(spot(rng), MONSTER_RADIUS, spot(rng)));
+        ProjectilePool start(count);
+        for (size_t i = 0; i < count; ++i)
+            start.spawn(glm::vec3(spot(rng), height(rng), spot(rng)),
+                        glm::normalize(glm::vec3(dir(rng), dir(rng) * 0.05f, dir(rng)) + glm::vec3(1e-3f)) * 25.0f);
+
+        ProjectilePool brute = start;
+        size_t bruteHits = 0;
+        double bruteMs = benchmarkBestOf(1, [&] {
+            for (int frame = 0; frame < frames; ++frame) {
+                brute.simulate(dt, glm::vec3(0.0f, -1000.0f, 0.0f), 0.0f);   // move + range cull only
+                for (size_t i = brute.size(); i-- > 0;) {
+                    glm::vec3 a = brute.prevPosition(i), b = brute.position(i);
+                    for (size_t m = 0; m < monsters.size(); ++m) {
+                        float t;
+                        if (!segmentEntersSphere(a, b, monsters.position(m), MONSTER_RADIUS, t)) continue;
+                        brute.remove(i);
+                        ++bruteHits;
+                        break;
+                    }
+                }
+            }
+        });
+
+        ProjectilePool paired = start;
+        SphereGrid grid;
+        std::vector<uint32_t> hits;
+        size_t gridHits = 0;
+        double buildMs = 0.0;
+        double gridMs = benchmarkBestOf(1, [&] {
+            for (int frame = 0; frame < frames; ++frame) {
+                buildMs += benchmarkBestOf(1, [&] { monsters.buildGrid(grid); });
+                hits.clear();
+                gridHits += paired.simulate(dt, grid, hits);
+            }
+        });
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  " << std::setw(5) << monsterCount << " monsters: every monster " << bruteMs / frames << " ms/frame, "
+                  << "grid " << gridMs / frames << " ms/frame (build " << buildMs / frames << " ms, "
+                  << std::setprecision(1) << bruteMs / gridMs << "x), hits " << bruteHits << " / " << gridHits
+                  << (bruteHits == gridHits ? "" : "  MISMATCH") << std::endl;
+    }
+}
+
+// Simulation cost per frame, stepping by the frame time vs the fixed 120 Hz
+// clock: 2 s of game (10k projectiles, 1000 monsters, 10k towers) played at
+// several frame rates, nothing is drawn. With the clock every rate runs the
+// same 240 steps (give or take the last partial one), so slow frames pay for
+// several steps and fast frames often for none.
+// ---------------------------------------------------------------------------
+inline void benchmarkFixedStep() {
+    const double gameSeconds = 2.0;
+    std::vector<Tower> towers;
+    srand(371);
+    float halfExtent = generateTowers(10000, towers);
+    AABBList boxes;
+    for (const auto& tower : towers) boxes.push(tower.position, towerExtent(tower));
+    SpatialGrid towerGrid;
+    towerGrid.build(boxes);
+
+    std::mt19937 rng(371);
+    float spread = std::min(halfExtent, 60.0f);
+    std::uniform_real_distribution<float> spot(-spread, spread), height(0.5f, 2.0f), dir(-1.0f, 1.0f);
+    MonsterPool monsters(1000);
+    while (monsters.size() < monsters.capacity()) monsters.spawn(glm::vec3(spot(rng), MONSTER_RADIUS, spot(rng)));
+    ProjectilePool start(10000);
+    while (start.size() < start.capacity()) {
+        glm::vec3 position(spot(rng), height(rng), spot(rng));
+        if (towerGrid.anyWithinRadius(position.x, position.z, 0.1f)) continue;
+        start.spawn(position, glm::normalize(glm::vec3(dir(rng), dir(rng) * 0.05f, dir(rng)) + glm::vec3(1e-3f)) * 25.0f);
+    }
+
+    std::cout << "BENCH: " << gameSeconds << " s of game at several frame rates, frame time steps vs fixed "
+              << SIMULATION_HZ << " Hz steps" << std::endl;
+    for (bool fixed : { false, true }) {
+        for (double fps : { 30.0, 60.0, 144.0, 240.0 }) {
+            ProjectilePool projectiles = start;
+            SphereGrid monsterGrid;
+            std::vector<uint32_t> hits;
+            FixedTimestep clock;
+            int frames = static_cast<int>(gameSeconds * fps + 0.5);
+            size_t steps = 0, hitCount = 0;
+            auto step = [&](float seconds) {
+                monsters.buildGrid(monsterGrid);
+                hits.clear();
+                hitCount += projectiles.simulate(seconds, monsterGrid, hits, &towerGrid);
+                ++steps;
+            };
+            double ms = benchmarkBestOf(1, [&] {
+                for (int frame = 0; frame < frames; ++frame) {
+                    if (!fixed) { step(static_cast<float>(1.0 / fps)); continue; }
+                    for (int s = clock.advance(1.0 / fps); s > 0; --s) step(static_cast<float>(clock.step()));
+                }
+            });
+            std::cout << std::fixed << std::setprecision(3)
+                      << "  " << (fixed ? "fixed step " : "frame step ") << std::setw(5) << std::setprecision(0) << fps << " fps: "
+                      << std::setprecision(3) << ms / frames << " ms sim/frame, " << steps << " steps, "
+                      << hitCount << " monster hits, " << projectiles.size() << " left" << std::endl;
+        }
+    }
+}
+
+// Job system: what spawning costs (empty jobs, empty parallelFor against
+// starting threads for every call like parallelFor used to), then the same
+// compute loop split over 1..N threads. With more threads than cores the
+// extra ones only time-slice, so the scaling runs stop at the hardware.
+// ---------------------------------------------------------------------------
+inline void benchmarkJobs() {
+    const unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "BENCH: job system, " << hardware << " hardware threads" << std::endl;
+    for (unsigned int threads : { 1u, hardware }) {
+        JobSystem jobs(threads);
+        const int batches = 200, perBatch = 512;
+        auto empty = [] {};
+        double runMs = benchmarkBestOf(5, [&] {
+            for (int b = 0; b < batches; ++b) {
+                JobCounter counter;
+                for (int j = 0; j < perBatch; ++j) jobs.run(counter, empty);
+                jobs.wait(counter);
+            }
+        });
+        const int calls = 10000;
+        double forMs = benchmarkBestOf(5, [&] {
+            for (int c = 0; c < calls; ++c) jobs.parallelFor(jobs.threadCount(), 1, [](size_t, size_t, size_t) {});
+        });
+        std::cout << std::fixed << std::setprecision(1)
+                  << "  " << jobs.threadCount() << " threads: " << 1e6 * runMs / (batches * perBatch) << " ns per empty job, "
+                  << 1e6 * forMs / calls << " ns per empty parallelFor" << std::endl;
+        if (threads == hardware) break;
+    }
+    if (hardware == 1) {
+        std::cout << "  single core: no worker threads, every job runs on the calling thread" << std::endl;
+    } else {
+        const int threadCalls = 200;
+        double threadMs = benchmarkBestOf(3, [&] {
+            for (int c = 0; c < threadCalls; ++c) {
+                std::vector<std::thread> threads;
+                for (unsigned int t = 1; t < hardware; ++t) threads.emplace_back([] {});
+                for (auto& thread : threads) thread.join();
+            }
+        });
+        std::cout << std::fixed << std::setprecision(1) << "  starting " << hardware - 1 << " threads per call instead: "
+                  << 1e6 * threadMs / threadCalls << " ns per call" << std::endl;
+    }
+
+    // Scaling: 4M square roots in 64 jobs of 64k, more jobs than threads so the stealing balances them
+    struct SquareRoots {
+        float* sum;
+        size_t begin, end;
+        void operator()() const {
+            float x = 0.0f;
+            for (size_t i = begin; i < end; ++i) x += std::sqrt(static_cast<float>(i));
+            *sum = x;
+        }
+    };
+    const size_t jobCount = 64, perJob = size_t(1) << 16;
+    std::vector<float> sums(jobCount);
+    std::vector<SquareRoots> work;
+    for (size_t j = 0; j < jobCount; ++j) work.push_back({ &sums[j], j * perJob, (j + 1) * perJob });
+    std::vector<unsigned int> threadCounts;
+    for (unsigned int threads = 1; threads < hardware; threads *= 2) threadCounts.push_back(threads);
+    threadCounts.push_back(hardware);
+    double baseMs = 0.0;
+    for (unsigned int threads : threadCounts) {
+        JobSystem jobs(threads);
+        double ms = benchmarkBestOf(5, [&] {
+            JobCounter counter;
+            for (const SquareRoots& job : work) jobs.run(counter, job);
+            jobs.wait(counter);
+        });
+        if (threads == 1) baseMs = ms;
+        std::cout << std::fixed << std::setprecision(3) << "  " << jobs.threadCount() << " threads: " << ms << " ms, "
+                  << std::setprecision(2) << baseMs / ms << "x" << std::endl;
+    }
+}
+
+// Flow field over cities of 256^2 and 2048^2 one meter cells: occupancy
+// rasterization, rebuilding the whole field when the target moves to the
+// next cell, the same out to 64 m only (what the game does), then 10k agents
+// walking along it. The field is checked against a plain Dijkstra.
+// ---------------------------------------------------------------------------
+inline void benchmarkFlowField() {
+    const size_t agentCount = 10000;
+    const int steps = 60;
+    std::cout << "BENCH: flow field, " << agentCount << " agents, " << workerCount() << " threads" << std::endl;
+    for (int cells : { 256, 2048 }) {
+        float half = 0.5f * cells * FLOW_CELL_SIZE;
+        std::vector<Tower> towers;
+        srand(371);
+        generateTowers(static_cast<int>(100.0f * (half / 40.0f) * (half / 40.0f)), towers);   // same density as the game
+        AABBList boxes;
+        for (const auto& tower : towers) boxes.push(tower.position, towerExtent(tower));
+
+        FlowField field;
+        double buildMs = benchmarkBestOf(3, [&] { field.build(boxes, MONSTER_RADIUS, glm::vec2(-half), glm::vec2(half)); });
+
+        // Moving one cell back and forth, every update is a rebuild
+        const glm::vec3 target(0.5f, 0.0f, 0.5f), step(FLOW_CELL_SIZE, 0.0f, 0.0f);
+        int moves = 0;
+        double fullMs = benchmarkBestOf(5, [&] { field.update(target + step * static_cast<float>(++moves & 1)); });
+        size_t fullSolves = field.tileSolves(), fullRounds = field.rounds(), fullTiles = field.reachedTiles();
+        double stillMs = benchmarkBestOf(5, [&] { field.update(target + step * static_cast<float>(moves & 1)); });
+        double windowMs = benchmarkBestOf(5, [&] { field.update(target + step * static_cast<float>(++moves & 1), 64.0f); });
+        size_t windowTiles = field.reachedTiles();
+
+        // Reference distances for the last full field
+        field.update(target);
+        std::vector<uint32_t> reference(static_cast<size_t>(field.width()) * field.height(), FLOW_UNREACHED);
+        using Item = std::pair<uint32_t, int>;
+        std::priority_queue<Item, std::vector<Item>, std::greater<Item>> open;
+        reference[field.targetCell()] = 0;
+        open.push({ 0, field.targetCell() });
+        while (!open.empty()) {
+            Item item = open.top();
+            open.pop();
+            if (item.first != reference[item.second]) continue;
+            int x = item.second % field.width(), y = item.second / field.width();
+            for (int n = 0; n < 8; ++n) {
+                int nx = x + FlowField::NEIGHBOUR_X[n], ny = y + FlowField::NEIGHBOUR_Y[n];
+                if (!field.canStep(x, y, nx, ny)) continue;
+                uint32_t d = item.first + (n < 4 ? FLOW_STRAIGHT_COST : FLOW_DIAGONAL_COST);
+                int neighbour = ny * field.width() + nx;
+                if (d < reference[neighbour]) {
+                    reference[neighbour] = d;
+                    open.push({ d, neighbour });
+                }
+            }
+        }
+        size_t mismatches = 0, reached = 0;
+        for (int y = 0; y < field.height(); ++y)
+            for (int x = 0; x < field.width(); ++x) {
+                mismatches += field.distance(x, y) != reference[static_cast<size_t>(y) * field.width() + x];
+                reached += field.distance(x, y) != FLOW_UNREACHED;
+            }
+
+        // Agents on random free cells all over the city
+        std::mt19937 rng(371);
+        std::uniform_real_distribution<float> spot(-half, half);
+        MonsterPool agents(agentCount);
+        while (agents.size() < agentCount) {
+            glm::vec3 p(spot(rng), MONSTER_RADIUS, spot(rng));
+            if (field.walkable(p)) agents.spawn(p);
+        }
+        double walkMs = benchmarkBestOf(1, [&] {
+            for (int s = 0; s < steps; ++s) agents.walk(field, target, static_cast<float>(SIMULATION_STEP));
+        });
+        size_t stuck = 0;
+        for (size_t i = 0; i < agents.size(); ++i) stuck += !field.walkable(agents.position(i));
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  " << field.width() << "x" << field.height() << " cells, " << towers.size() << " towers: occupancy "
+                  << buildMs << " ms" << std::endl
+                  << "    target moved a cell: " << fullMs << " ms (" << fullTiles << " tiles, " << fullSolves << " tile solves, "
+                  << fullRounds << " rounds), still in its cell: " << stillMs << " ms" << std::endl
+                  << "    out to 64 m only: " << windowMs << " ms (" << windowTiles << " tiles)" << std::endl
+                  << "    " << agentCount << " agents: " << walkMs / steps << " ms/step, " << stuck << " inside a tower" << std::endl
+                  << "    " << reached << " cells reached, " << mismatches << " differ from Dijkstra" << std::endl;
+    }
+}
+
+// The game's frame loop with the simulation on the main thread vs its own
+// thread: each frame hands the input over, takes the newest snapshot and
+// "renders" (fixed CPU work standing in for the GL calls). The simulation
+// is the real one, 4096 monsters walking, 10k towers, shots every frame.
+// Threaded, the frame only pays for the snapshot hand-over; on a single
+// core the two threads share it and nothing is won.
+// ---------------------------------------------------------------------------
+inline void benchmarkSimThread() {
+    const double seconds = 2.0, renderMs = 4.0;
+    const int shotsPerFrame = 32;
+    std::vector<Tower> towers;
+    srand(371);
+    float halfExtent = generateTowers(10000, towers);
+    AABBList boxes;
+    for (const auto& tower : towers) boxes.push(tower.position, towerExtent(tower));
+    SpatialGrid towerGrid;
+    towerGrid.build(boxes);
+    FlowField paths;
+    paths.build(boxes, MONSTER_RADIUS, glm::vec2(-halfExtent), glm::vec2(halfExtent));
+    float spread = std::min(halfExtent, 60.0f);
+
+    // Render work: a fixed amount of CPU work, not a wall clock wait, so a
+    // thread sharing the core makes it take longer. Sized to renderMs once.
+    volatile float sink = 0.0f;
+    size_t renderIterations = 1 << 16;
+    auto renderWork = [&] {
+        float x = 1.0f;
+        for (size_t i = 0; i < renderIterations; ++i) x = std::sqrt(x + static_cast<float>(i));
+        return x;
+    };
+    double calibrationMs = benchmarkBestOf(3, [&] { sink = sink + renderWork(); });
+    renderIterations = static_cast<size_t>(renderIterations * renderMs / std::max(calibrationMs, 1e-3));
+
+    std::cout << "BENCH: " << seconds << " s of frames with " << renderMs << " ms of render work, "
+              << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+    for (bool threaded : { false, true }) {
+        std::mt19937 rng(371);
+        std::uniform_real_distribution<float> spot(-spread, spread), height(0.5f, 2.0f), dir(-1.0f, 1.0f);
+        GameSimulation simulation;
+        simulation.spawnPoint = [&](const glm::vec3&) { return glm::vec3(spot(rng), MONSTER_RADIUS, spot(rng)); };
+        TripleBuffer<SimulationInput> inputs;
+        TripleBuffer<WorldSnapshot> snapshots;
+        SimulationInput input;
+        simulation.flowRadius = spread + 16.0f;
+        simulation.reset(&towerGrid, &paths, glm::vec3(0.0f, 1.0f, 0.0f), 0.0f, static_cast<int>(MAX_MONSTERS), snapshots);
+        inputs.writeBuffer() = input;
+        inputs.publish();
+        if (threaded) simulation.start(inputs, snapshots);
+
+        size_t frames = 0, fresh = 0, drawn = 0;
+        double simMs = 0.0;
+        auto begin = std::chrono::steady_clock::now();
+        double elapsed = 0.0;
+        while (elapsed < seconds) {
+            // shots are fired by the simulation thread too, so keep them away from the pool's capacity
+            if (snapshots.readBuffer().projectiles.size() + shotsPerFrame < MAX_PROJECTILES) {
+                for (int shot = 0; shot < shotsPerFrame; ++shot)
+                    input.fire(glm::vec3(spot(rng), height(rng), spot(rng)),
+                               glm::normalize(glm::vec3(dir(rng), 0.0f, dir(rng)) + glm::vec3(1e-3f)) * 25.0f);
+            }
+            inputs.writeBuffer() = input;
+            inputs.publish();
+            if (!threaded) {
+                auto simStart = std::chrono::steady_clock::now();
+                inputs.acquire();
+                simulation.update(inputs.readBuffer(), snapshots);
+                simMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - simStart).count();
+            }
+            fresh += snapshots.acquire();
+            const WorldSnapshot& world = snapshots.readBuffer();
+            drawn += world.projectiles.size() + world.monsters.size();
+            sink = sink + renderWork();
+            ++frames;
+            elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        }
+        simulation.stop();
+        const WorldSnapshot& world = snapshots.readBuffer();
+        std::cout << std::fixed << std::setprecision(3)
+                  << "  " << (threaded ? "sim thread " : "main thread") << ": " << 1000.0 * elapsed / frames << " ms/frame, "
+                  << std::setprecision(1) << frames / elapsed << " fps, " << world.steps << " steps ("
+                  << std::setprecision(3) << 1000.0 * world.simSeconds / std::max<uint64_t>(world.steps, 1) << " ms each), "
+                  << fresh << " new snapshots, " << (threaded ? 0.0 : simMs / frames) << " ms sim/frame on the main thread, "
+                  << drawn / std::max<size_t>(frames, 1) << " objects drawn/frame" << std::endl;
+    }
+}
+
+// GPU benchmarks (--bench shadowkernels / skybox / prepass / lights) need the GPU
+// so they run in the game: the camera is frozen and every variant is drawn for a
+// fixed number of frames. Each metric is averaged per variant and compared with
+// the first variant (no shadow lookups, sky drawn first, no depth pre-pass,
+// forward lighting without point lights).
+// ----------------------------------------------------------------------------
+inline bool isGpuBenchmark(const std::string& name) {
+    return name == "shadowkernels" || name == "skybox" || name == "prepass" || name == "lights";
+}
+
+class GpuVariantBenchmark {
+public:
+    int warmupFrames = 60;      // lets the GPU queries catch up after a switch
+    int measuredFrames = 300;
+
+    void start(const std::string& benchName, const std::string& benchTitle,
+               const std::vector<std::string>& variantNames, const std::vector<std::string>& metricNames) {
+        name = benchName;
+        title = benchTitle;
+        variants = variantNames;
+        metrics = metricNames;
+        totals.assign(variants.size() * metrics.size(), 0.0);
+        samples.assign(variants.size(), 0);
+        current = 0;
+        frame = 0;
+        active = !variants.empty();
+    }
+    bool running() const { return active; }
+    const std::string& benchmark() const { return name; }
+    int variant() const { return current; }
+
+    // Feed this frame's metrics (in start order), moves to the next variant after
+    // measuredFrames, prints the results and stops after the last one
+    void addFrame(bool hasSample, std::initializer_list<double> values) {
+        if (!active) return;
+        if (frame >= warmupFrames && hasSample) {
+            size_t m = 0;
+            for (double value : values) {
+                if (m < metrics.size()) totals[current * metrics.size() + m] += value;
+                ++m;
+            }
+            ++samples[current];
+        }
+        if (++frame < warmupFrames + measuredFrames) return;
+        frame = 0;
+        if (++current < static_cast<int>(variants.size())) return;
+        active = false;
+        report();
+    }
+
+private:
+    std::string name;
+    std::string title;
+    std::vector<std::string> variants;
+    std::vector<std::string> metrics;
+    std::vector<double> totals;
+    std::vector<int> samples;
+    bool active = false;
+    int current = 0;
+    int frame = 0;
+
+    double average(size_t variant, size_t metric) const {
+        return samples[variant] ? totals[variant * metrics.size() + metric] / samples[variant] : 0.0;
+    }
+
+    void report() const {
+        std::cout << "BENCH: " << title << ", " << measuredFrames << " frames each (difference to " << variants[0] << ")" << std::endl;
+        for (size_t v = 0; v < variants.size(); ++v) {
+            std::cout << std::fixed << std::setprecision(3) << "  " << std::setw(16) << variants[v] << ":";
+            for (size_t m = 0; m < metrics.size(); ++m) {
+                std::cout << " " << metrics[m] << " " << average(v, m);
+                if (v > 0) std::cout << " (" << std::showpos << average(v, m) - average(0, m) << std::noshowpos << ")";
+                std::cout << (m + 1 < metrics.size() ? "," : "");
+            }
+            std::cout << std::endl;
+        }
+    }
+};
+
+// Dispatch a benchmark by name ("all" runs every one), returns false if the name is unknown
+// -----------------------------------------------------------------------------------------
+inline bool runBenchmark(const std::string& name) {
+    struct Entry { const char* name; void (*run)(); };
+    static const Entry entries[] = {
+        { "cull", benchmarkFrustumCulling },
+        { "occlusion", benchmarkOcclusionCulling },
+        { "shadows", benchmarkShadowCasters },
+        { "shadowcache", benchmarkShadowCache },
+        { "clusters", benchmarkClusters },
+        { "projectiles", benchmarkProjectiles },
+        { "grid", benchmarkSpatialGrid },
+        { "collisions", benchmarkProjectileCollisions },
+        { "monsters", benchmarkMonsters },
+        { "fixedstep", benchmarkFixedStep },
+        { "simthread", benchmarkSimThread },
+        { "jobs", benchmarkJobs },
+        { "flowfield", benchmarkFlowField },
+    };
+
+    bool found = false;
+    for (const auto& entry : entries) {
+        if (name != "all" && name != entry.name) continue;
+        entry.run();
+        found = true;
+    }
+    if (!found) {
+        std::cerr << "Unknown benchmark: " << name << ", available: all";
+        for (const auto& entry : entries) std::cerr << ", " << entry.name;
+        std::cerr << ", shadowkernels, skybox, prepass, lights (GPU, in game)";
+        std::cerr << std::endl;
+    }
+    return found;
+}
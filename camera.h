@@ -15,7 +15,6 @@ public:
     float fastSpeed;
     float horizontalAngle;
     float verticalAngle;
-    float dt;
     float currentSpeed;
     float theta;
     float phi;
@@ -44,18 +43,18 @@ public:
         return glm::lookAt(position, position + lookAt, up);
     }
 
-    // Update camera orientation every frame
-    // -------------------------------------
-    void updateOrientation(double mouseX, double mouseY, float deltaTime) {
-        dt = deltaTime;
+    // Update camera orientation every frame, straight from the mouse motion
+    // (not scaled by the frame time, the mouse delta already is per frame)
+    // ----------------------------------------------------------------------
+    void updateOrientation(double mouseX, double mouseY) {
         double dx = mouseX - lastMouseX;
         double dy = mouseY - lastMouseY;
         lastMouseX = mouseX;
         lastMouseY = mouseY;
 
-        const float angularSpeed = 60.0f;
-        horizontalAngle -= dx * angularSpeed * dt;
-        verticalAngle -= dy * angularSpeed * dt;
+        const float degreesPerPixel = 1.0f;   // what 60 deg/s per pixel gave at 60 fps
+        horizontalAngle -= dx * degreesPerPixel;
+        verticalAngle -= dy * degreesPerPixel;
 
         verticalAngle = glm::clamp(verticalAngle, -85.0f, 85.0f);
 
@@ -97,20 +96,4 @@ public:
     float getYaw(){
         return horizontalAngle;
     }
-
-    // Process camera inputs
-    // ---------------------
-    void processInput(GLFWwindow* window) {
-        bool isFast = glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS || glfwGetKey(window, GLFW_KEY_RIGHT_SHIFT) == GLFW_PRESS;
-        currentSpeed = isFast ? fastSpeed : speed;
-
-        if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-            position += lookAt * dt * currentSpeed;
-        if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-            position -= lookAt * dt * currentSpeed;
-        if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-            position += sideVector * dt * currentSpeed;
-        if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-            position -= sideVector * dt * currentSpeed;
-    }
 };
\ No newline at end of file
@@ -0,0 +1,283 @@
+#pragma once
+
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "lights.h"
+#include "parallel.h"
+#include "shader.h"
+
+// Clustered forward lighting: the view frustum is cut into 16 x 9 screen tiles
+// and 24 depth slices. Every frame the CPU lists the point lights touching each
+// cluster, and Phong.frag / Monster.frag (compiled with clusteredDefines()) only
+// loop over the lights of their own cluster.
+// -----------------------------------------------------------------------------
+constexpr int CLUSTER_X = 16;
+constexpr int CLUSTER_Y = 9;
+constexpr int CLUSTER_Z = 24;
+constexpr int CLUSTER_TILES = CLUSTER_X * CLUSTER_Y;
+constexpr int CLUSTER_COUNT = CLUSTER_TILES * CLUSTER_Z;
+constexpr int MAX_LIGHTS_PER_CLUSTER = 256;
+// Slice 0 covers [near, 1) and the other slices split [1, far) logarithmically,
+// otherwise half of them would be spent on the first meter in front of the camera
+constexpr float CLUSTER_NEAR_SPLIT = 1.0f;
+
+inline std::string clusteredDefines() {
+    return "#define CLUSTERED_LIGHTING 1\n"
+           "#define CLUSTER_X " + std::to_string(CLUSTER_X) + "\n"
+           "#define CLUSTER_Y " + std::to_string(CLUSTER_Y) + "\n"
+           "#define CLUSTER_Z " + std::to_string(CLUSTER_Z) + "\n";
+}
+
+// Where the lights of one cluster start in the index list, and how many there are
+struct ClusterRecord {
+    uint32_t offset;
+    uint32_t count;
+};
+
+class ClusteredLights {
+public:
+    // The G-buffer units, the deferred and clustered paths never draw together
+    static constexpr int LIGHTS_UNIT = 10;
+    static constexpr int RECORDS_UNIT = 11;
+    static constexpr int INDICES_UNIT = 12;
+
+    bool multithreaded = true;   // build the lists with parallelFor
+
+    bool create() {
+        // Errors left by earlier calls are not ours, drain them so the check below only sees these calls
+        while (glGetError() != GL_NO_ERROR) {}
+        glGenBuffers(1, &lightBuffer);
+        glGenBuffers(1, &recordBuffer);
+        glGenBuffers(1, &indexBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, MAX_POINT_LIGHTS * sizeof(PointLight), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, recordBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, CLUSTER_COUNT * sizeof(ClusterRecord), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, sizeof(uint16_t), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        lightTexture = createBufferTexture(lightBuffer, GL_RGBA32F);     // 2 texels per light
+        recordTexture = createBufferTexture(recordBuffer, GL_RG32UI);
+        indexTexture = createBufferTexture(indexBuffer, GL_R16UI);       // MAX_POINT_LIGHTS fits in 16 bits
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        ready = lightBuffer && recordBuffer && indexBuffer && lightTexture && recordTexture && indexTexture &&
+                MAX_POINT_LIGHTS * 2 <= maxTexels && CLUSTER_COUNT <= maxTexels && glGetError() == GL_NO_ERROR;
+        if (!ready) std::cerr << "CLUSTER LOG: texture buffers unavailable, clustered path disabled" << std::endl;
+        else std::cout << "CLUSTER LOG: " << CLUSTER_X << "x" << CLUSTER_Y << "x" << CLUSTER_Z << " light clusters" << std::endl;
+        return ready;
+    }
+
+    bool isReady() const { return ready; }
+
+    // Assign the lights to the clusters of this view. Pure CPU, no GL calls, so
+    // the benchmarks can run it without a context. Two parallel steps: the depth
+    // slices each light spans, then one task per range of slices fills the
+    // tiles of its slices into its own list. The lists are joined in slice order.
+    // ---------------------------------------------------------------------------
+    void build(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane,
+               const std::vector<PointLight>& lights) {
+        lightCount = std::min(lights.size(), static_cast<size_t>(MAX_POINT_LIGHTS));
+        lightData.assign(lights.begin(), lights.begin() + lightCount);
+        projectionX = projection[0][0];
+        projectionY = projection[1][1];
+        nearDepth = nearPlane;
+        farDepth = farPlane;
+        sliceScale = (CLUSTER_Z - 1) / std::log(farDepth / CLUSTER_NEAR_SPLIT);
+
+        bounds.resize(lightCount);
+        parallelFor(lightCount, multithreaded ? 256 : lightCount, [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                LightBounds& b = bounds[i];
+                b.center = glm::vec3(view * glm::vec4(glm::vec3(lightData[i].positionRadius), 1.0f));
+                b.radius = lightData[i].positionRadius.w;
+                float depth = -b.center.z;
+                if (depth + b.radius < nearDepth || depth - b.radius > farDepth) {
+                    b.firstSlice = 1;
+                    b.lastSlice = 0;
+                    continue;
+                }
+                b.firstSlice = sliceOf(std::max(depth - b.radius, nearDepth));
+                b.lastSlice = sliceOf(std::min(depth + b.radius, farDepth));
+            }
+        });
+
+        records.resize(CLUSTER_COUNT);
+        taskIndices.resize(workerCount());
+        taskRects.resize(workerCount());
+        taskSlices.assign(workerCount(), { 0, 0 });
+        for (auto& list : taskIndices) list.clear();
+        parallelFor(CLUSTER_Z, multithreaded ? 1 : CLUSTER_Z, [&](size_t task, size_t begin, size_t end) {
+            taskSlices[task] = { begin, end };
+            std::vector<uint16_t>& out = taskIndices[task];
+            std::vector<TileRect>& rects = taskRects[task];
+            for (size_t slice = begin; slice < end; ++slice) {
+                uint32_t counts[CLUSTER_TILES] = {};
+                rects.clear();
+                float sliceNear = sliceDepth(static_cast<int>(slice));
+                float sliceFar = sliceDepth(static_cast<int>(slice) + 1);
+                for (size_t i = 0; i < lightCount; ++i) {
+                    const LightBounds& b = bounds[i];
+                    if (static_cast<int>(slice) < b.firstSlice || static_cast<int>(slice) > b.lastSlice) continue;
+                    TileRect rect;
+                    if (!tilesInSlice(b, sliceNear, sliceFar, rect)) continue;
+                    rect.light = static_cast<uint16_t>(i);
+                    rects.push_back(rect);
+                    for (int y = rect.y0; y <= rect.y1; ++y)
+                        for (int x = rect.x0; x <= rect.x1; ++x) ++counts[y * CLUSTER_X + x];
+                }
+
+                ClusterRecord* sliceRecords = &records[slice * CLUSTER_TILES];
+                uint32_t offset = static_cast<uint32_t>(out.size());
+                for (int tile = 0; tile < CLUSTER_TILES; ++tile) {
+                    sliceRecords[tile].offset = offset;
+                    sliceRecords[tile].count = std::min<uint32_t>(counts[tile], MAX_LIGHTS_PER_CLUSTER);
+                    offset += sliceRecords[tile].count;
+                }
+                out.resize(offset);
+                uint32_t filled[CLUSTER_TILES] = {};
+                for (const auto& rect : rects)
+                    for (int y = rect.y0; y <= rect.y1; ++y)
+                        for (int x = rect.x0; x <= rect.x1; ++x) {
+                            int tile = y * CLUSTER_X + x;
+                            if (filled[tile] < sliceRecords[tile].count)
+                                out[sliceRecords[tile].offset + filled[tile]++] = rect.light;
+                        }
+            }
+        });
+
+        // Join the task lists, the record offsets become global
+        size_t total = 0;
+        for (const auto& list : taskIndices) total += list.size();
+        indices.resize(total);
+        size_t base = 0;
+        maxPerCluster = 0;
+        for (size_t task = 0; task < taskIndices.size(); ++task) {
+            const auto& range = taskSlices[task];
+            if (range.first >= range.second) continue;
+            std::copy(taskIndices[task].begin(), taskIndices[task].end(), indices.begin() + base);
+            for (size_t c = range.first * CLUSTER_TILES; c < range.second * CLUSTER_TILES; ++c) {
+                records[c].offset += static_cast<uint32_t>(base);
+                maxPerCluster = std::max<size_t>(maxPerCluster, records[c].count);
+            }
+            base += taskIndices[task].size();
+        }
+    }
+
+    // Stream the lights, the cluster records and the index list to the GPU
+    void upload() const {
+        glBindBuffer(GL_TEXTURE_BUFFER, lightBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, MAX_POINT_LIGHTS * sizeof(PointLight), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, lightCount * sizeof(PointLight), lightData.data());
+        glBindBuffer(GL_TEXTURE_BUFFER, recordBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, CLUSTER_COUNT * sizeof(ClusterRecord), records.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, indexBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, std::max<size_t>(1, indices.size()) * sizeof(uint16_t),
+                     indices.empty() ? NULL : indices.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // Bind the cluster data to a program compiled with clusteredDefines()
+    void bind(Shader& shader, int screenWidth, int screenHeight) const {
+        bindBufferTexture(LIGHTS_UNIT, lightTexture);
+        bindBufferTexture(RECORDS_UNIT, recordTexture);
+        bindBufferTexture(INDICES_UNIT, indexTexture);
+        shader.use();
+        shader.setInt("clusterLights", LIGHTS_UNIT);
+        shader.setInt("clusterRecords", RECORDS_UNIT);
+        shader.setInt("clusterIndices", INDICES_UNIT);
+        glUniform2f(glGetUniformLocation(shader.ID, "clusterScreenSize"), static_cast<float>(screenWidth), static_cast<float>(screenHeight));
+        glUniform1f(glGetUniformLocation(shader.ID, "clusterSplit"), CLUSTER_NEAR_SPLIT);
+        glUniform1f(glGetUniformLocation(shader.ID, "clusterScale"), sliceScale);
+    }
+
+    size_t indexCount() const { return indices.size(); }
+    size_t maxClusterLights() const { return maxPerCluster; }
+    const std::vector<ClusterRecord>& clusterRecords() const { return records; }
+
+private:
+    struct LightBounds {
+        glm::vec3 center;   // view space
+        float radius;
+        int firstSlice;
+        int lastSlice;      // < firstSlice when the light is outside the depth range
+    };
+    struct TileRect {
+        int x0, y0, x1, y1;
+        uint16_t light;
+    };
+
+    bool ready = false;
+    GLuint lightBuffer = 0, recordBuffer = 0, indexBuffer = 0;
+    GLuint lightTexture = 0, recordTexture = 0, indexTexture = 0;
+
+    float projectionX = 1.0f, projectionY = 1.0f;
+    float nearDepth = 0.1f, farDepth = 100.0f;
+    float sliceScale = 1.0f;
+    size_t lightCount = 0;
+    size_t maxPerCluster = 0;
+    std::vector<PointLight> lightData;
+    std::vector<LightBounds> bounds;
+    std::vector<ClusterRecord> records;
+    std::vector<uint16_t> indices;
+    std::vector<std::vector<uint16_t>> taskIndices;
+    std::vector<std::vector<TileRect>> taskRects;
+    std::vector<std::pair<size_t, size_t>> taskSlices;
+
+    // Same mapping as ClusterIndex() in the shaders
+    int sliceOf(float depth) const {
+        if (depth < CLUSTER_NEAR_SPLIT) return 0;
+        return std::min(CLUSTER_Z - 1, 1 + static_cast<int>(std::log(depth / CLUSTER_NEAR_SPLIT) * sliceScale));
+    }
+
+    float sliceDepth(int slice) const {
+        if (slice <= 0) return nearDepth;
+        if (slice >= CLUSTER_Z) return farDepth;
+        return CLUSTER_NEAR_SPLIT * std::exp((slice - 1) / sliceScale);
+    }
+
+    // Tiles covered by the part of the sphere inside [sliceNear, sliceFar]: its
+    // widest cross-section there, extruded over the slab, projected at both ends
+    bool tilesInSlice(const LightBounds& b, float sliceNear, float sliceFar, TileRect& rect) const {
+        float depth = -b.center.z;
+        float zNear = std::max(sliceNear, depth - b.radius);
+        float zFar = std::min(sliceFar, depth + b.radius);
+        if (zNear > zFar) return false;
+        float dz = depth < zNear ? zNear - depth : (depth > zFar ? depth - zFar : 0.0f);
+        float r = std::sqrt(std::max(b.radius * b.radius - dz * dz, 0.0f));
+
+        auto range = [&](float center, float scale, int tiles, int& first, int& last) {
+            float lo = scale * std::min((center - r) / zNear, (center - r) / zFar);
+            float hi = scale * std::max((center + r) / zNear, (center + r) / zFar);
+            if (hi < -1.0f || lo > 1.0f) return false;
+            first = std::clamp(static_cast<int>(std::floor((lo * 0.5f + 0.5f) * tiles)), 0, tiles - 1);
+            last = std::clamp(static_cast<int>(std::floor((hi * 0.5f + 0.5f) * tiles)), 0, tiles - 1);
+            return true;
+        };
+        return range(b.center.x, projectionX, CLUSTER_X, rect.x0, rect.x1) &&
+               range(b.center.y, projectionY, CLUSTER_Y, rect.y0, rect.y1);
+    }
+
+    static GLuint createBufferTexture(GLuint buffer, GLenum format) {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+        glTexBuffer(GL_TEXTURE_BUFFER, format, buffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        return texture;
+    }
+
+    static void bindBufferTexture(int unit, GLuint texture) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_BUFFER, texture);
+    }
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <iostream>
+#include <vector>
+
+#include "geometry.h"
+#include "lights.h"
+#include "renderer.h"
+#include "shader.h"
+#include "shadows.h"
+
+// Deferred shading: the opaque geometry writes albedo (+ specular strength in
+// alpha), world normals and depth into a G-buffer. The lighting pass then runs
+// the two shadowed lights once per pixel in a full screen triangle and adds
+// every point light with an instanced cube around its sphere, so the cost is
+// the pixels each light covers, not lights x geometry. The full screen pass
+// also writes the G-buffer depth into the default framebuffer for the sky.
+// ----------------------------------------------------------------------------
+class DeferredRenderer {
+public:
+    static constexpr int ALBEDO_UNIT = 10;
+    static constexpr int NORMAL_UNIT = 11;
+    static constexpr int DEPTH_UNIT = 12;
+    static constexpr int SHADOW_UNIT = 14;
+
+    bool create(Geometry& geometry, int screenWidth, int screenHeight, ShadowKernel kernel) {
+        width = screenWidth;
+        height = screenHeight;
+
+        glGenFramebuffers(1, &gBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        albedoTexture = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+        normalTexture = createTarget(GL_RGBA16F, GL_RGBA, GL_FLOAT);
+        depthTexture = createTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_FLOAT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, albedoTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+        const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, drawBuffers);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!complete) {
+            std::cerr << "DEFERRED LOG: G-buffer is not complete, deferred path disabled" << std::endl;
+            return false;
+        }
+
+        mainLightShader = new Shader("Shaders/DeferredLight.vert", "Shaders/DeferredLight.frag", shadowKernelDefines(kernel));
+        pointLightShader = new Shader("Shaders/PointLight.vert", "Shaders/PointLight.frag");
+        glGenVertexArrays(1, &screenVAO);
+
+        // Unit cube + per light instance data (position/radius, color/intensity)
+        glGenBuffers(1, &lightVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, lightVBO);
+        glBufferData(GL_ARRAY_BUFFER, MAX_POINT_LIGHTS * sizeof(PointLight), NULL, GL_STREAM_DRAW);
+        volumeVAO = geometry.createDepthCube();
+        glBindVertexArray(volumeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, lightVBO);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(PointLight), (void*)0);
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(PointLight), (void*)sizeof(glm::vec4));
+        glEnableVertexAttribArray(4);
+        glVertexAttribDivisor(4, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+
+        ready = true;
+        std::cout << "DEFERRED LOG: " << width << "x" << height << " G-buffer created" << std::endl;
+        return true;
+    }
+
+    bool isReady() const { return ready; }
+
+    // The full screen pass shares the shadow code of Phong.frag, recompile it with the kernel
+    void setShadowKernel(ShadowKernel kernel) {
+        if (ready) mainLightShader->relink("Shaders/DeferredLight.vert", "Shaders/DeferredLight.frag", shadowKernelDefines(kernel));
+    }
+
+    // Bind and clear the G-buffer, the opaque geometry is drawn after this
+    void beginGeometryPass() const {
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        glViewport(0, 0, width, height);
+        Renderer::clear();
+    }
+
+    // Light the G-buffer into the default framebuffer, returns the point lights drawn
+    size_t lightingPass(const glm::mat4& view, const glm::mat4& projection, const glm::vec3& viewPos,
+                        const glm::vec3& lightPos1, const glm::vec3& lightPos2,
+                        const CascadedShadowMap& shadows, const std::vector<PointLight>& lights) {
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, width, height);
+        Renderer::clear();
+        glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+        bindTarget(ALBEDO_UNIT, albedoTexture);
+        bindTarget(NORMAL_UNIT, normalTexture);
+        bindTarget(DEPTH_UNIT, depthTexture);
+
+        // Shadowed lights, the depth test always passes so the G-buffer depth is copied
+        mainLightShader->use();
+        setTargets(*mainLightShader, inverseViewProjection, viewPos);
+        mainLightShader->setMat4("view", view);
+        mainLightShader->setVec3("lightPos1", lightPos1);
+        mainLightShader->setVec3("lightPos2", lightPos2);
+        shadows.bind(*mainLightShader, SHADOW_UNIT);
+        glDepthFunc(GL_ALWAYS);
+        glBindVertexArray(screenVAO);
+        Renderer::drawArrays(GL_TRIANGLES, 0, 3);
+        glDepthFunc(GL_LESS);
+
+        // Point lights, additive. Back faces without depth test so a light still
+        // shades when the camera is inside its volume.
+        size_t count = std::min(lights.size(), static_cast<size_t>(MAX_POINT_LIGHTS));
+        if (count > 0) {
+            glBindBuffer(GL_ARRAY_BUFFER, lightVBO);
+            glBufferData(GL_ARRAY_BUFFER, MAX_POINT_LIGHTS * sizeof(PointLight), NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(PointLight), lights.data());
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+            pointLightShader->use();
+            setTargets(*pointLightShader, inverseViewProjection, viewPos);
+            pointLightShader->setMat4("view", view);
+            pointLightShader->setMat4("projection", projection);
+            glUniform2f(glGetUniformLocation(pointLightShader->ID, "screenSize"), static_cast<float>(width), static_cast<float>(height));
+
+            GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+            GLint cullMode; glGetIntegerv(GL_CULL_FACE_MODE, &cullMode);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            glDisable(GL_DEPTH_TEST);
+            glDepthMask(GL_FALSE);
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_FRONT);
+
+            glBindVertexArray(volumeVAO);
+            Renderer::drawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(count));
+
+            glCullFace(cullMode);
+            if (!cullFace) glDisable(GL_CULL_FACE);
+            glDepthMask(GL_TRUE);
+            glEnable(GL_DEPTH_TEST);
+            glDisable(GL_BLEND);
+        }
+        glBindVertexArray(0);
+        return count;
+    }
+
+private:
+    int width = 0;
+    int height = 0;
+    bool ready = false;
+    GLuint gBuffer = 0;
+    GLuint albedoTexture = 0;
+    GLuint normalTexture = 0;
+    GLuint depthTexture = 0;
+    GLuint screenVAO = 0;
+    GLuint volumeVAO = 0;
+    GLuint lightVBO = 0;
+    Shader* mainLightShader = nullptr;
+    Shader* pointLightShader = nullptr;
+
+    GLuint createTarget(GLint internalFormat, GLenum format, GLenum type) const {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        return texture;
+    }
+
+    static void bindTarget(int unit, GLuint texture) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(GL_TEXTURE_2D, texture);
+    }
+
+    static void setTargets(Shader& shader, const glm::mat4& inverseViewProjection, const glm::vec3& viewPos) {
+        shader.setInt("gAlbedo", ALBEDO_UNIT);
+        shader.setInt("gNormal", NORMAL_UNIT);
+        shader.setInt("gDepth", DEPTH_UNIT);
+        shader.setMat4("inverseViewProjection", inverseViewProjection);
+        shader.setVec3("viewPos", viewPos);
+    }
+};
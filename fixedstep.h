@@ -0,0 +1,49 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+constexpr double SIMULATION_HZ = 120.0;
+constexpr double SIMULATION_STEP = 1.0 / SIMULATION_HZ;   // seconds simulated per step
+constexpr int MAX_SIMULATION_STEPS = 12;                  // per frame, 100 ms of game time at 120 Hz
+
+// Fixed timestep clock: the frame's real time goes into an accumulator that
+// is spent in whole simulation steps, so the game behaves the same at any
+// frame rate and a projectile never moves more than one step at a time. What
+// is left (less than a step) is the interpolation factor between the last two
+// simulated states for drawing. After a long stall (loading, a breakpoint)
+// the steps past MAX_SIMULATION_STEPS are dropped instead of simulating
+// frames that would take even longer to catch up.
+// ---------------------------------------------------------------------------
+class FixedTimestep {
+public:
+    explicit FixedTimestep(double step = SIMULATION_STEP, int maxSteps = MAX_SIMULATION_STEPS)
+        : mStep(step), mMaxSteps(maxSteps) {}
+
+    // Add the frame's real time, returns how many steps to simulate now
+    int advance(double frameSeconds) {
+        mAccumulator += std::max(frameSeconds, 0.0);
+        int steps = static_cast<int>(std::floor(mAccumulator / mStep));
+        if (steps > mMaxSteps) {
+            mDroppedSteps += static_cast<size_t>(steps - mMaxSteps);
+            mAccumulator -= (steps - mMaxSteps) * mStep;
+            steps = mMaxSteps;
+        }
+        mAccumulator -= steps * mStep;
+        return steps;
+    }
+
+    double step() const { return mStep; }
+
+    // Where the frame falls between the previous step (0) and the last one (1)
+    float alpha() const { return static_cast<float>(mAccumulator / mStep); }
+
+    size_t droppedSteps() const { return mDroppedSteps; }
+
+private:
+    double mStep;
+    int mMaxSteps;
+    double mAccumulator = 0.0;
+    size_t mDroppedSteps = 0;
+};
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "frustum.h"    // AABBList
+#include "parallel.h"
+
+constexpr float FLOW_CELL_SIZE = 1.0f;          // meters, grows when the city needs more than FLOW_MAX_CELLS
+constexpr int FLOW_MAX_CELLS = 2048;            // per side
+constexpr int FLOW_TILE = 32;                   // cells per tile side, the unit of work of the parallel solve
+constexpr uint32_t FLOW_STRAIGHT_COST = 10;     // step costs, about 1 : sqrt(2)
+constexpr uint32_t FLOW_DIAGONAL_COST = 14;
+constexpr uint32_t FLOW_UNREACHED = 0xffffffffu;
+
+// Flow field over the XZ plane shared by every monster: an occupancy grid of
+// the towers (inflated by the agent radius, rasterized once) and the walking
+// distance of every free cell to the target, 8-connected without cutting
+// corners. An agent only has to look at the 8 cells around it to know where
+// to go, whatever the number of agents.
+//
+// The distances are solved in tiles of FLOW_TILE x FLOW_TILE cells on the job
+// system: a tile runs a bucket-queue Dijkstra seeded by the cells its
+// neighbours improved, and tiles whose border changed wake their neighbours.
+// Tiles are solved in 4 colors (x and y parity), so tiles solved at the same
+// time never touch the same cells. A tile only runs once the wave from the
+// target reaches it, and the field is only rebuilt when the target changes
+// cell, out to a radius around the target.
+// ---------------------------------------------------------------------------
+class FlowField {
+public:
+    // Rasterize the boxes in [min, max] (XZ), one band of rows per job
+    void build(const AABBList& obstacles, float agentRadius, const glm::vec2& min, const glm::vec2& max,
+               float cellSize = FLOW_CELL_SIZE) {
+        glm::vec2 size = glm::max(max - min, glm::vec2(cellSize));
+        mCellSize = std::max(cellSize, std::max(size.x, size.y) / FLOW_MAX_CELLS);
+        mInvCellSize = 1.0f / mCellSize;
+        mOrigin = min;
+        mWidth = std::min(FLOW_MAX_CELLS, static_cast<int>(std::ceil(size.x * mInvCellSize)));
+        mHeight = std::min(FLOW_MAX_CELLS, static_cast<int>(std::ceil(size.y * mInvCellSize)));
+        mTilesX = (mWidth + FLOW_TILE - 1) / FLOW_TILE;
+        mTilesY = (mHeight + FLOW_TILE - 1) / FLOW_TILE;
+
+        mBlocked.assign(static_cast<size_t>(mWidth) * mHeight, 0);
+        parallelFor(mHeight, 64, [&](size_t, size_t row0, size_t row1) {
+            for (size_t i = 0; i < obstacles.size(); ++i) {
+                int y0 = std::max(static_cast<int>(row0), cellY(obstacles.centerZ[i] - obstacles.extentZ[i] - agentRadius));
+                int y1 = std::min(static_cast<int>(row1) - 1, cellY(obstacles.centerZ[i] + obstacles.extentZ[i] + agentRadius));
+                if (y0 > y1) continue;
+                int x0 = cellX(obstacles.centerX[i] - obstacles.extentX[i] - agentRadius);
+                int x1 = cellX(obstacles.centerX[i] + obstacles.extentX[i] + agentRadius);
+                for (int y = y0; y <= y1; ++y)
+                    std::fill(mBlocked.begin() + index(x0, y), mBlocked.begin() + index(x1, y) + 1, uint8_t(1));
+            }
+        });
+
+        mDistance.assign(mBlocked.size(), FLOW_UNREACHED);
+        mTileState.assign(static_cast<size_t>(mTilesX) * mTilesY, 0);
+        mChangedSides.assign(mTileState.size(), 0);
+        mTouched.clear();
+        mTargetCell = -1;
+    }
+
+    // Rebuild the distances toward target when it moved to another cell,
+    // only out to radius (meters, 0 = the whole grid). Returns true if rebuilt.
+    bool update(const glm::vec3& target, float radius = 0.0f) {
+        mTarget = target;
+        int cell = nearestFreeCell(cellX(target.x), cellY(target.z));
+        if (cell == mTargetCell && radius == mRadius) return false;
+        mTargetCell = cell;
+        mRadius = radius;
+        mTileSolves = 0;
+        mRounds = 0;
+
+        // Forget the previous field, only the tiles it reached hold distances
+        parallelFor(mTouched.size(), 16, [&](size_t, size_t begin, size_t end) {
+            for (size_t t = begin; t < end; ++t) {
+                int tile = mTouched[t];
+                forEachRow(tile, [&](int x0, int x1, int y) {
+                    std::fill(mDistance.begin() + index(x0, y), mDistance.begin() + index(x1, y), FLOW_UNREACHED);
+                });
+                mTileState[tile] = 0;
+            }
+        });
+        mTouched.clear();
+        if (mTargetCell < 0) return true;   // boxed in, agents go straight
+
+        int targetX = mTargetCell % mWidth, targetY = mTargetCell / mWidth;
+        int reach = radius > 0.0f ? static_cast<int>(std::ceil(radius * mInvCellSize / FLOW_TILE)) : mTilesX + mTilesY;
+        mWindowX0 = std::max(0, targetX / FLOW_TILE - reach);
+        mWindowX1 = std::min(mTilesX - 1, targetX / FLOW_TILE + reach);
+        mWindowY0 = std::max(0, targetY / FLOW_TILE - reach);
+        mWindowY1 = std::min(mTilesY - 1, targetY / FLOW_TILE + reach);
+
+        mDistance[mTargetCell] = 0;
+        std::vector<int> active{ (targetY / FLOW_TILE) * mTilesX + targetX / FLOW_TILE };
+        activate(active[0]);
+        std::vector<int> colorTiles;
+        while (!active.empty()) {
+            ++mRounds;
+            for (auto& tile : active) mTileState[tile] &= ~ACTIVE;
+            for (int color = 0; color < 4; ++color) {
+                colorTiles.clear();
+                for (int tile : active)
+                    if (tileColor(tile) == color) colorTiles.push_back(tile);
+                parallelFor(colorTiles.size(), 1, [&](size_t, size_t begin, size_t end) {
+                    for (size_t t = begin; t < end; ++t) solveTile(colorTiles[t]);
+                });
+                mTileSolves += colorTiles.size();
+            }
+            // A tile wakes the neighbours on the sides where its border changed
+            std::vector<int> next;
+            for (int tile : active) {
+                uint16_t sides = mChangedSides[tile];
+                mChangedSides[tile] = 0;
+                int tx = tile % mTilesX, ty = tile / mTilesX;
+                for (int side = 0; sides; ++side, sides >>= 1) {
+                    if (!(sides & 1)) continue;
+                    int nx = tx + side % 3 - 1, ny = ty + side / 3 - 1;
+                    if (nx < mWindowX0 || nx > mWindowX1 || ny < mWindowY0 || ny > mWindowY1) continue;
+                    int neighbour = ny * mTilesX + nx;
+                    if (mTileState[neighbour] & ACTIVE) continue;
+                    activate(neighbour);
+                    next.push_back(neighbour);
+                }
+            }
+            active.swap(next);
+        }
+        return true;
+    }
+
+    // Unit XZ direction to walk from position: toward the center of the
+    // neighbouring cell closest to the target, straight at the target from
+    // its own cell, and straight at it from anywhere the field did not reach
+    glm::vec3 direction(const glm::vec3& position) const {
+        if (mBlocked.empty()) return straightTo(mTarget, position);
+        int x = cellX(position.x), y = cellY(position.z);
+        int cell = index(x, y);
+        uint32_t best = mDistance[cell];
+        int bestCell = -1;
+        if (cell != mTargetCell) {
+            for (int n = 0; n < 8; ++n) {
+                int nx = x + NEIGHBOUR_X[n], ny = y + NEIGHBOUR_Y[n];
+                if (!canStep(x, y, nx, ny)) continue;
+                uint32_t d = mDistance[index(nx, ny)];
+                if (d < best) {
+                    best = d;
+                    bestCell = index(nx, ny);
+                }
+            }
+        }
+        if (bestCell < 0) return straightTo(mTarget, position);
+        glm::vec2 to = cellCenter(bestCell);
+        return straightTo(glm::vec3(to.x, 0.0f, to.y), position);
+    }
+
+    // False inside an (inflated) obstacle, outside the grid is free
+    bool walkable(const glm::vec3& position) const {
+        int x = static_cast<int>(std::floor((position.x - mOrigin.x) * mInvCellSize));
+        int y = static_cast<int>(std::floor((position.z - mOrigin.y) * mInvCellSize));
+        if (x < 0 || y < 0 || x >= mWidth || y >= mHeight) return true;
+        return !mBlocked[index(x, y)];
+    }
+
+    int width() const { return mWidth; }
+    int height() const { return mHeight; }
+    float cellSize() const { return mCellSize; }
+    bool blocked(int x, int y) const { return mBlocked[index(x, y)] != 0; }
+    uint32_t distance(int x, int y) const { return mDistance[index(x, y)]; }
+    int targetCell() const { return mTargetCell; }
+    size_t tileSolves() const { return mTileSolves; }   // in the last rebuild
+    size_t rounds() const { return mRounds; }
+    size_t reachedTiles() const { return mTouched.size(); }
+
+    // The 8 neighbours, straight ones first
+    static constexpr int NEIGHBOUR_X[8] = { 1, -1, 0, 0, 1, -1, 1, -1 };
+    static constexpr int NEIGHBOUR_Y[8] = { 0, 0, 1, -1, 1, 1, -1, -1 };
+
+    // A step to a free neighbour, diagonal only if both cells beside it are free
+    bool canStep(int x, int y, int nx, int ny) const {
+        if (nx < 0 || ny < 0 || nx >= mWidth || ny >= mHeight || mBlocked[index(nx, ny)]) return false;
+        return nx == x || ny == y || (!mBlocked[index(nx, y)] && !mBlocked[index(x, ny)]);
+    }
+
+private:
+    static constexpr uint8_t ACTIVE = 1;          // waiting for the next round
+    static constexpr uint8_t SOLVED = 2;          // reached in this rebuild
+
+    glm::vec2 mOrigin{ 0.0f };
+    float mCellSize = FLOW_CELL_SIZE, mInvCellSize = 1.0f / FLOW_CELL_SIZE;
+    int mWidth = 0, mHeight = 0, mTilesX = 0, mTilesY = 0;
+    int mWindowX0 = 0, mWindowX1 = -1, mWindowY0 = 0, mWindowY1 = -1;
+    std::vector<uint8_t> mBlocked;
+    std::vector<uint32_t> mDistance;
+    std::vector<uint8_t> mTileState;
+    std::vector<uint16_t> mChangedSides;          // per tile, bit (dy + 1) * 3 + dx + 1: a border cell next to that neighbour improved
+    std::vector<int> mTouched;                    // tiles holding distances
+    glm::vec3 mTarget{ 0.0f };
+    int mTargetCell = -1;
+    float mRadius = 0.0f;
+    size_t mTileSolves = 0, mRounds = 0;
+
+    int cellX(float x) const { return std::clamp(static_cast<int>(std::floor((x - mOrigin.x) * mInvCellSize)), 0, mWidth - 1); }
+    int cellY(float z) const { return std::clamp(static_cast<int>(std::floor((z - mOrigin.y) * mInvCellSize)), 0, mHeight - 1); }
+    size_t index(int x, int y) const { return static_cast<size_t>(y) * mWidth + x; }
+    glm::vec2 cellCenter(int cell) const {
+        return mOrigin + (glm::vec2(cell % mWidth, cell / mWidth) + glm::vec2(0.5f)) * mCellSize;
+    }
+    static glm::vec3 straightTo(const glm::vec3& to, const glm::vec3& from) {
+        glm::vec2 d(to.x - from.x, to.z - from.z);
+        float length = glm::length(d);
+        return length > 1e-5f ? glm::vec3(d.x / length, 0.0f, d.y / length) : glm::vec3(0.0f);
+    }
+    int tileColor(int tile) const { return (tile % mTilesX & 1) | (tile / mTilesX & 1) << 1; }
+
+    void activate(int tile) {
+        if (!(mTileState[tile] & SOLVED)) {
+            mTileState[tile] |= SOLVED;
+            mTouched.push_back(tile);
+        }
+        mTileState[tile] |= ACTIVE;
+    }
+
+    // fn(x0, x1, y) for each row of the tile's cells, x1 exclusive
+    template <typename Fn>
+    void forEachRow(int tile, Fn&& fn) const {
+        int x0 = tile % mTilesX * FLOW_TILE, y0 = tile / mTilesX * FLOW_TILE;
+        int x1 = std::min(mWidth, x0 + FLOW_TILE), y1 = std::min(mHeight, y0 + FLOW_TILE);
+        for (int y = y0; y < y1; ++y) fn(x0, x1, y);
+    }
+
+    // The free cell closest to (x, y) within 8 cells, -1 if there is none
+    int nearestFreeCell(int x, int y) const {
+        for (int ring = 0; ring <= 8; ++ring)
+            for (int dy = -ring; dy <= ring; ++dy)
+                for (int dx = -ring; dx <= ring; ++dx) {
+                    if (std::max(std::abs(dx), std::abs(dy)) != ring) continue;
+                    int nx = x + dx, ny = y + dy;
+                    if (nx >= 0 && ny >= 0 && nx < mWidth && ny < mHeight && !mBlocked[index(nx, ny)]) return static_cast<int>(index(nx, ny));
+                }
+        return -1;
+    }
+
+    // Dijkstra inside one tile with a ring of buckets (step costs are at most
+    // FLOW_DIAGONAL_COST, so 16 buckets hold every pending distance). The tile
+    // and the ring of cells around it are copied into a padded local block,
+    // so neighbours are constant offsets without bounds checks and the whole
+    // solve stays in L1. Seeds: cells next to the ring that the neighbouring
+    // tiles improved, and the target on the tile's first solve.
+    void solveTile(int tile) {
+        constexpr int P = FLOW_TILE + 2;   // padded row
+        const int offsets[8] = { 1, -1, P, -P, P + 1, P - 1, -P + 1, -P - 1 };   // NEIGHBOUR_X/Y order
+        struct Seed { uint32_t distance; uint16_t cell; };
+        thread_local uint32_t distance[P * P];
+        thread_local uint8_t free[P * P];       // walkable, in the tile or its ring
+        thread_local uint8_t inside[P * P];     // walkable and in the tile: the cells this solve may change
+        thread_local std::vector<Seed> seeds;
+        thread_local std::vector<uint16_t> buckets[16];
+
+        int x0 = tile % mTilesX * FLOW_TILE, y0 = tile / mTilesX * FLOW_TILE;
+        int w = std::min(mWidth - x0, FLOW_TILE), h = std::min(mHeight - y0, FLOW_TILE);
+        for (int ly = 0; ly < P; ++ly)
+            for (int lx = 0; lx < P; ++lx) {
+                int x = x0 + lx - 1, y = y0 + ly - 1, local = ly * P + lx;
+                bool inGrid = x >= 0 && y >= 0 && x < mWidth && y < mHeight;
+                distance[local] = inGrid ? mDistance[index(x, y)] : FLOW_UNREACHED;
+                free[local] = inGrid && !mBlocked[index(x, y)];
+                inside[local] = free[local] && lx >= 1 && ly >= 1 && lx <= w && ly <= h;
+            }
+        // Cost of the step from cell toward neighbour n, 0 if it can't be taken (canStep).
+        // Steps are symmetric, so it is also the cost of the step back.
+        auto stepCost = [&](int cell, int n) -> uint32_t {
+            if (!free[cell + offsets[n]]) return 0;
+            if (n < 4) return FLOW_STRAIGHT_COST;
+            return free[cell + NEIGHBOUR_X[n]] && free[cell + NEIGHBOUR_Y[n] * P] ? FLOW_DIAGONAL_COST : 0;
+        };
+        seeds.clear();
+        if (mTargetCell >= 0) {
+            int tx = mTargetCell % mWidth - x0 + 1, ty = mTargetCell / mWidth - y0 + 1;
+            if (tx >= 1 && ty >= 1 && tx <= w && ty <= h && distance[ty * P + tx] == 0)
+                seeds.push_back({ 0, static_cast<uint16_t>(ty * P + tx) });
+        }
+        for (int ly = 1; ly <= h; ++ly)
+            for (int lx = 1; lx <= w; lx += (ly == 1 || ly == h || lx == w) ? 1 : std::max(1, w - 1)) {
+                int cell = ly * P + lx;
+                if (!inside[cell]) continue;
+                uint32_t best = distance[cell];
+                for (int n = 0; n < 8; ++n) {
+                    int from = cell + offsets[n];
+                    uint32_t cost = stepCost(cell, n);
+                    if (!inside[from] && cost && distance[from] != FLOW_UNREACHED) best = std::min(best, distance[from] + cost);
+                }
+                if (best < distance[cell]) {
+                    distance[cell] = best;
+                    seeds.push_back({ best, static_cast<uint16_t>(cell) });
+                }
+            }
+        if (seeds.empty()) return;
+        std::sort(seeds.begin(), seeds.end(), [](const Seed& a, const Seed& b) { return a.distance < b.distance; });
+
+        size_t nextSeed = 0, pending = 0;
+        uint32_t current = seeds[0].distance;
+        while (pending > 0 || nextSeed < seeds.size()) {
+            if (pending == 0) current = std::max(current, seeds[nextSeed].distance);
+            for (; nextSeed < seeds.size() && seeds[nextSeed].distance == current; ++nextSeed) {
+                buckets[current & 15].push_back(seeds[nextSeed].cell);
+                ++pending;
+            }
+            std::vector<uint16_t>& bucket = buckets[current & 15];
+            for (size_t b = 0; b < bucket.size(); ++b) {
+                int cell = bucket[b];
+                --pending;
+                if (distance[cell] != current) continue;   // improved since it was queued
+                for (int n = 0; n < 8; ++n) {
+                    int to = cell + offsets[n];
+                    if (!inside[to]) continue;
+                    uint32_t cost = stepCost(cell, n);
+                    if (!cost || current + cost >= distance[to]) continue;
+                    distance[to] = current + cost;
+                    buckets[(current + cost) & 15].push_back(static_cast<uint16_t>(to));
+                    ++pending;
+                }
+            }
+            bucket.clear();
+            ++current;
+        }
+
+        // Write the tile back, a changed border cell wakes the neighbours it touches
+        uint16_t sides = 0;
+        for (int ly = 1; ly <= h; ++ly) {
+            uint32_t* row = &mDistance[index(x0, y0 + ly - 1)];
+            int dy = ly == 1 ? -1 : ly == h ? 1 : 0;
+            for (int lx = 1; lx <= w; ++lx) {
+                uint32_t d = distance[ly * P + lx];
+                if (d == row[lx - 1]) continue;
+                row[lx - 1] = d;
+                int dx = lx == 1 ? -1 : lx == w ? 1 : 0;
+                if (dx) sides |= 1 << (4 + dx);
+                if (dy) sides |= 1 << (4 + dy * 3);
+                if (dx && dy) sides |= 1 << (4 + dy * 3 + dx);
+            }
+        }
+        mChangedSides[tile] = sides;
+    }
+};
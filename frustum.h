@@ -0,0 +1,271 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include "parallel.h"
+
+// View frustum as 6 planes (xyz = normal pointing inside, w = distance),
+// extracted from a view-projection matrix (Gribb/Hartmann)
+// ----------------------------------------------------------------------
+struct Frustum {
+    glm::vec4 planes[6];
+
+    static Frustum fromMatrix(const glm::mat4& m) {
+        // glm is column major, m[col][row]
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        Frustum f;
+        f.planes[0] = row3 + row0; // left
+        f.planes[1] = row3 - row0; // right
+        f.planes[2] = row3 + row1; // bottom
+        f.planes[3] = row3 - row1; // top
+        f.planes[4] = row3 + row2; // near
+        f.planes[5] = row3 - row2; // far
+        for (auto& p : f.planes)
+            p = p / glm::length(glm::vec3(p));
+        return f;
+    }
+
+    // Box given as center + half extent, true if it is at least partially inside
+    bool intersectsAABB(const glm::vec3& center, const glm::vec3& extent) const {
+        for (const auto& p : planes) {
+            float d = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+            float r = std::abs(p.x) * extent.x + std::abs(p.y) * extent.y + std::abs(p.z) * extent.z;
+            if (d + r < 0.0f) return false;
+        }
+        return true;
+    }
+
+    // Same test for the box swept along `sweep` (the volume between the box and the box + sweep)
+    bool intersectsSweptAABB(const glm::vec3& center, const glm::vec3& extent, const glm::vec3& sweep) const {
+        for (const auto& p : planes) {
+            float d = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+            float r = std::abs(p.x) * extent.x + std::abs(p.y) * extent.y + std::abs(p.z) * extent.z;
+            float moved = p.x * sweep.x + p.y * sweep.y + p.z * sweep.z;
+            if (std::max(d, d + moved) + r < 0.0f) return false;
+        }
+        return true;
+    }
+};
+
+// Axis aligned boxes as structure of arrays (center + half extent),
+// so the SIMD kernels can load 4 or 8 boxes per component at once
+// -----------------------------------------------------------------
+struct AABBList {
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    size_t size() const { return centerX.size(); }
+
+    void reserve(size_t n) {
+        for (auto* v : { &centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ })
+            v->reserve(n);
+    }
+
+    void push(const glm::vec3& center, const glm::vec3& extent) {
+        centerX.push_back(center.x); centerY.push_back(center.y); centerZ.push_back(center.z);
+        extentX.push_back(extent.x); extentY.push_back(extent.y); extentZ.push_back(extent.z);
+    }
+};
+
+enum class CullKernel { Scalar, SSE, AVX2 };
+
+inline const char* cullKernelName(CullKernel kernel) {
+    switch (kernel) {
+        case CullKernel::Scalar: return "Scalar";
+        case CullKernel::SSE:    return "SSE";
+        case CullKernel::AVX2:   return "AVX2";
+        default:                 return "Unknown";
+    }
+}
+
+// Widest kernel this binary was compiled for
+inline CullKernel bestCullKernel() {
+#if defined(__AVX2__)
+    return CullKernel::AVX2;
+#elif defined(__SSE2__) || defined(_M_X64)
+    return CullKernel::SSE;
+#else
+    return CullKernel::Scalar;
+#endif
+}
+
+// Test boxes [first, last) one at a time, append the visible indices
+// ------------------------------------------------------------------
+inline size_t cullAABBsScalar(const Frustum& frustum, const AABBList& boxes, size_t first, size_t last, uint32_t* out) {
+    size_t count = 0;
+    for (size_t i = first; i < last; ++i) {
+        glm::vec3 c(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+        glm::vec3 e(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+        if (frustum.intersectsAABB(c, e)) out[count++] = static_cast<uint32_t>(i);
+    }
+    return count;
+}
+
+#if defined(__SSE2__) || defined(_M_X64)
+// Boxes [first, last), 4 per step, returns how many indices were written
+// ----------------------------------------------------------------------
+inline size_t cullAABBsSSE(const Frustum& frustum, const AABBList& boxes, size_t first, size_t last, uint32_t* out) {
+    const __m128 zero = _mm_setzero_ps();
+    size_t count = 0;
+    size_t i = first;
+    for (; i + 4 <= last; i += 4) {
+        __m128 cx = _mm_loadu_ps(&boxes.centerX[i]);
+        __m128 cy = _mm_loadu_ps(&boxes.centerY[i]);
+        __m128 cz = _mm_loadu_ps(&boxes.centerZ[i]);
+        __m128 ex = _mm_loadu_ps(&boxes.extentX[i]);
+        __m128 ey = _mm_loadu_ps(&boxes.extentY[i]);
+        __m128 ez = _mm_loadu_ps(&boxes.extentZ[i]);
+
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (const auto& p : frustum.planes) {
+            // signed distance of the center + projected radius of the box on the normal
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), cx),
+                                             _mm_mul_ps(_mm_set1_ps(p.y), cy)),
+                                  _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), cz), _mm_set1_ps(p.w)));
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::abs(p.x)), ex),
+                                             _mm_mul_ps(_mm_set1_ps(std::abs(p.y)), ey)),
+                                  _mm_mul_ps(_mm_set1_ps(std::abs(p.z)), ez));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), zero));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        for (int b = 0; b < 4; ++b)
+            if (mask & (1 << b)) out[count++] = static_cast<uint32_t>(i + b);
+    }
+    return count + cullAABBsScalar(frustum, boxes, i, last, out + count);
+}
+#endif
+
+#if defined(__AVX2__)
+// Boxes [first, last), 8 per step, returns how many indices were written
+// ----------------------------------------------------------------------
+inline size_t cullAABBsAVX2(const Frustum& frustum, const AABBList& boxes, size_t first, size_t last, uint32_t* out) {
+    const __m256 zero = _mm256_setzero_ps();
+    size_t count = 0;
+    size_t i = first;
+    for (; i + 8 <= last; i += 8) {
+        __m256 cx = _mm256_loadu_ps(&boxes.centerX[i]);
+        __m256 cy = _mm256_loadu_ps(&boxes.centerY[i]);
+        __m256 cz = _mm256_loadu_ps(&boxes.centerZ[i]);
+        __m256 ex = _mm256_loadu_ps(&boxes.extentX[i]);
+        __m256 ey = _mm256_loadu_ps(&boxes.extentY[i]);
+        __m256 ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (const auto& p : frustum.planes) {
+            __m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.x), cx),
+                                                   _mm256_mul_ps(_mm256_set1_ps(p.y), cy)),
+                                     _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.z), cz), _mm256_set1_ps(p.w)));
+            __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::abs(p.x)), ex),
+                                                   _mm256_mul_ps(_mm256_set1_ps(std::abs(p.y)), ey)),
+                                     _mm256_mul_ps(_mm256_set1_ps(std::abs(p.z)), ez));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(d, r), zero, _CMP_GE_OQ));
+        }
+
+        int mask = _mm256_movemask_ps(inside);
+        for (int b = 0; b < 8; ++b)
+            if (mask & (1 << b)) out[count++] = static_cast<uint32_t>(i + b);
+    }
+    return count + cullAABBsScalar(frustum, boxes, i, last, out + count);
+}
+#endif
+
+// Cull [first, last) with the given kernel, returns how many indices were written.
+// Kernels that were not compiled in fall back to the next narrower one.
+// --------------------------------------------------------------------------------
+inline size_t cullAABBRange(const Frustum& frustum, const AABBList& boxes, size_t first, size_t last, uint32_t* out,
+                            CullKernel kernel) {
+    switch (kernel) {
+#if defined(__AVX2__)
+        case CullKernel::AVX2:
+            return cullAABBsAVX2(frustum, boxes, first, last, out);
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#if !defined(__AVX2__)
+        case CullKernel::AVX2:
+#endif
+        case CullKernel::SSE:
+            return cullAABBsSSE(frustum, boxes, first, last, out);
+#endif
+        default:
+            return cullAABBsScalar(frustum, boxes, first, last, out);
+    }
+}
+
+constexpr size_t CULL_BOXES_PER_TASK = 16384;   // below this many boxes culling stays on the calling thread
+
+// Fill visible with the indices of the boxes touching the frustum, in order.
+// Big lists are split into ranges culled on the job system, each writes its
+// indices at the start of its own range of visible and the ranges are then
+// moved down next to each other.
+// --------------------------------------------------------------------------
+inline void cullAABBs(const Frustum& frustum, const AABBList& boxes, std::vector<uint32_t>& visible,
+                      CullKernel kernel = bestCullKernel()) {
+    visible.resize(boxes.size());
+    struct Range { size_t begin = 0, count = 0; };
+    Range ranges[MAX_JOB_QUEUES];   // one per task, parallelFor never makes more than workerCount()
+    parallelFor(boxes.size(), CULL_BOXES_PER_TASK, [&](size_t task, size_t begin, size_t end) {
+        ranges[task] = { begin, cullAABBRange(frustum, boxes, begin, end, visible.data() + begin, kernel) };
+    });
+
+    size_t count = ranges[0].count;
+    for (size_t task = 1; task < workerCount(); ++task) {
+        // Already in place when every earlier box was visible (std::copy can't overlap its source)
+        if (count != ranges[task].begin)
+            std::copy(visible.begin() + ranges[task].begin, visible.begin() + ranges[task].begin + ranges[task].count,
+                      visible.begin() + count);
+        count += ranges[task].count;
+    }
+    visible.resize(count);
+}
+
+// Shadow caster culling: keep only the boxes whose shadow can land inside the
+// receiver frustum. Each box is extruded along the light direction down to the
+// ground plane (capped at maxLength), a caster whose extruded volume misses the
+// receivers can't darken anything visible. Filters casters in place, returns
+// how many were removed.
+// ----------------------------------------------------------------------------
+inline glm::vec3 shadowSweep(const glm::vec3& center, const glm::vec3& extent, const glm::vec3& lightDir,
+                             float groundY, float maxLength) {
+    float length = maxLength;
+    if (lightDir.y < -1e-3f) length = std::min(maxLength, (center.y + extent.y - groundY) / -lightDir.y);
+    return lightDir * std::max(length, 0.0f);
+}
+
+inline size_t cullShadowCasters(const Frustum& receivers, const AABBList& boxes, const glm::vec3& lightDir,
+                                float groundY, float maxLength, std::vector<uint32_t>& casters) {
+    size_t kept = 0;
+    for (uint32_t index : casters) {
+        glm::vec3 c(boxes.centerX[index], boxes.centerY[index], boxes.centerZ[index]);
+        glm::vec3 e(boxes.extentX[index], boxes.extentY[index], boxes.extentZ[index]);
+        if (receivers.intersectsSweptAABB(c, e, shadowSweep(c, e, lightDir, groundY, maxLength))) casters[kept++] = index;
+    }
+    size_t removed = casters.size() - kept;
+    casters.resize(kept);
+    return removed;
+}
+
+// Bit l of masks[i] tells if box i is in lists[l] (at most 8 lists), merged
+// gets the boxes in any list in increasing order. masks is sized to the
+// number of boxes.
+// -------------------------------------------------------------------------
+inline void listMasks(const std::vector<uint32_t>* lists, size_t listCount, size_t boxCount,
+                      std::vector<uint8_t>& masks, std::vector<uint32_t>& merged) {
+    merged.clear();
+    masks.assign(boxCount, 0);
+    for (size_t l = 0; l < listCount; ++l)
+        for (uint32_t index : lists[l]) masks[index] |= static_cast<uint8_t>(1u << l);
+    for (size_t i = 0; i < boxCount; ++i)
+        if (masks[i]) merged.push_back(static_cast<uint32_t>(i));
+}
@@ -169,7 +169,117 @@ class Geometry{
 
             return lightCubeVAO;
         }
-        void createSkybox(){
+        // Create a lightCube VAO that also reads one vec4 per instance
+        // (xyz = position, w = height) from the given buffer at location 3
+        // -----------------------------------------------------------------
+        GLuint createInstancedLightCube(GLuint instanceVBO){
+            GLuint instancedVAO = createLightCube();
+
+            glBindVertexArray(instancedVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            // instance attribute, advances once per instance instead of per vertex
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(3);
+            glVertexAttribDivisor(3, 1);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+            return instancedVAO;
+        }
+        // Positions only version of the lightCube (same winding), for depth passes
+        // that don't need normals or texture coordinates
+        // ------------------------------------------------------------------------
+        GLuint createDepthCube(){
+            const float depthCubeVertices[] = {
+            // Front face
+            -0.5f, -0.5f,  0.5f,
+             0.5f, -0.5f,  0.5f,
+             0.5f,  0.5f,  0.5f,
+             0.5f,  0.5f,  0.5f,
+            -0.5f,  0.5f,  0.5f,
+            -0.5f, -0.5f,  0.5f,
+            // Back face
+            -0.5f, -0.5f, -0.5f,
+            -0.5f,  0.5f, -0.5f,
+             0.5f,  0.5f, -0.5f,
+             0.5f,  0.5f, -0.5f,
+             0.5f, -0.5f, -0.5f,
+            -0.5f, -0.5f, -0.5f,
+            // Left face
+            -0.5f,  0.5f,  0.5f,
+            -0.5f,  0.5f, -0.5f,
+            -0.5f, -0.5f, -0.5f,
+            -0.5f, -0.5f, -0.5f,
+            -0.5f, -0.5f,  0.5f,
+            -0.5f,  0.5f,  0.5f,
+            // Right face
+             0.5f,  0.5f,  0.5f,
+             0.5f, -0.5f, -0.5f,
+             0.5f,  0.5f, -0.5f,
+             0.5f, -0.5f, -0.5f,
+             0.5f,  0.5f,  0.5f,
+             0.5f, -0.5f,  0.5f,
+            // Bottom face
+            -0.5f, -0.5f, -0.5f,
+             0.5f, -0.5f, -0.5f,
+             0.5f, -0.5f,  0.5f,
+             0.5f, -0.5f,  0.5f,
+            -0.5f, -0.5f,  0.5f,
+            -0.5f, -0.5f, -0.5f,
+            // Top face
+            -0.5f,  0.5f, -0.5f,
+            -0.5f,  0.5f,  0.5f,
+             0.5f,  0.5f,  0.5f,
+             0.5f,  0.5f,  0.5f,
+             0.5f,  0.5f, -0.5f,
+            -0.5f,  0.5f, -0.5f
+            };
+            GLuint depthCubeVAO, depthCubeVBO;
+            glGenVertexArrays(1, &depthCubeVAO);
+            glGenBuffers(1, &depthCubeVBO);
+
+            glBindVertexArray(depthCubeVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, depthCubeVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(depthCubeVertices), depthCubeVertices, GL_STATIC_DRAW);
+            // position
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+            return depthCubeVAO;
+        }
+        // Depth cube with the per instance tower attribute at location 3
+        // --------------------------------------------------------------
+        GLuint createInstancedDepthCube(GLuint instanceVBO){
+            GLuint instancedVAO = createDepthCube();
+
+            glBindVertexArray(instancedVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(3);
+            glVertexAttribDivisor(3, 1);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+            return instancedVAO;
+        }
+        // Add the per-instance shadow layer slot of (caster, layer) pair streams
+        // to an instanced VAO, read from slotVBO at location 5 as an integer
+        // -----------------------------------------------------------------------
+        static void addLayerSlots(GLuint instancedVAO, GLuint slotVBO, GLenum type = GL_UNSIGNED_BYTE){
+            glBindVertexArray(instancedVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, slotVBO);
+            glVertexAttribIPointer(5, 1, type, 0, (void*)0);
+            glEnableVertexAttribArray(5);
+            glVertexAttribDivisor(5, 1);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+        }
+        // Skybox cube, positions only, seen from the inside
+        // --------------------------------------------------
+        GLuint createSkybox(){
             const float skyboxVertices[] = {
                 -1.0f,  1.0f, -1.0f,
                 -1.0f, -1.0f, -1.0f,
@@ -213,6 +323,20 @@ class Geometry{
                 -1.0f, -1.0f,  1.0f,
                 1.0f, -1.0f,  1.0f
             };
+            GLuint skyboxVAO, skyboxVBO;
+            glGenVertexArrays(1, &skyboxVAO);
+            glGenBuffers(1, &skyboxVBO);
+
+            glBindVertexArray(skyboxVAO);
+            glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+            glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), skyboxVertices, GL_STATIC_DRAW);
+            // position
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(0);
+
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            glBindVertexArray(0);
+            return skyboxVAO;
         }
 };
 
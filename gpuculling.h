@@ -0,0 +1,147 @@
+#pragma once
+
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "frustum.h"
+#include "geometry.h"
+#include "renderer.h"
+#include "shader.h"
+#include "towers.h"
+
+// GPU driven towers: instances live in an SSBO, a compute shader frustum culls
+// them into a compacted instance buffer and fills DrawArraysIndirectCommands,
+// and each pass draws with glMultiDrawArraysIndirect (no per-tower CPU work).
+// Needs GL 4.3 (compute + SSBO + multi draw indirect), e.g. Mesa llvmpipe.
+// ----------------------------------------------------------------------------
+class GpuTowerCulling {
+public:
+    // One command per pass, each owns its own region of the visible buffer.
+    // The light pass appends a (tower, layer) pair for every shadow layer a
+    // tower touches, the layered shadow draw reads the slot of each pair.
+    enum Pass { CameraPass = 0, LightPass = 1, PassCount };
+    static constexpr int MAX_FRUSTUMS = 8;
+
+    static bool isSupported() {
+        return GLEW_VERSION_4_3 || (GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_multi_draw_indirect);
+    }
+
+    bool create(Geometry& geometry, const std::vector<Tower>& towers) {
+        if (!isSupported()) {
+            std::cout << "GPU CULLING LOG: compute shaders / multi draw indirect not supported, mode disabled" << std::endl;
+            return false;
+        }
+        cullShader = new Shader("Shaders/TowerCull.comp");
+        towerCount = static_cast<GLuint>(towers.size());
+
+        std::vector<glm::vec4> instances;
+        instances.reserve(towers.size());
+        for (const auto& tower : towers)
+            instances.push_back(glm::vec4(tower.position, tower.height));
+
+        glGenBuffers(1, &towerSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, towerSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(glm::vec4), instances.data(), GL_STATIC_DRAW);
+
+        // The camera's towers, then room for every tower in every layer
+        GLuint capacity = (1 + MAX_FRUSTUMS) * towerCount;
+        glGenBuffers(1, &visibleSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(glm::vec4), NULL, GL_DYNAMIC_COPY);
+        glGenBuffers(1, &slotSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, slotSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, capacity * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glGenBuffers(1, &commandBuffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, sizeof(resetCommands), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        for (GLuint pass = 0; pass < PassCount; ++pass)
+            resetCommands[pass] = { 36, 0, 0, pass * towerCount };
+
+        // The compacted list is read back as the regular per-instance attribute
+        VAO = geometry.createInstancedLightCube(visibleSSBO);
+        depthVAO = geometry.createInstancedDepthCube(visibleSSBO);
+        Geometry::addLayerSlots(depthVAO, slotSSBO, GL_UNSIGNED_INT);
+        ready = true;
+        return true;
+    }
+
+    bool isReady() const { return ready; }
+
+    // Cull the towers on the GPU, call once per frame before drawing. The camera
+    // pass keeps the towers in its frustum, the light pass one (tower, layer)
+    // pair per light frustum a tower touches (slot = index in lightFrustums).
+    void cull(const Frustum* cameraFrustum, const Frustum* lightFrustums, GLuint lightFrustumCount, bool frustumCulling) {
+        if (!ready || towerCount == 0) return;
+
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(resetCommands), resetCommands);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        cullShader->use();
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, towerSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, slotSSBO);
+        glUniform1ui(glGetUniformLocation(cullShader->ID, "towerCount"), towerCount);
+        glUniform1f(glGetUniformLocation(cullShader->ID, "towerWidth"), TOWER_WIDTH);
+
+        lightFrustumCount = std::min<GLuint>(lightFrustumCount, MAX_FRUSTUMS);
+        dispatch(CameraPass, cameraFrustum, 1, frustumCulling);
+        if (lightFrustumCount > 0) dispatch(LightPass, lightFrustums, lightFrustumCount, frustumCulling);
+
+        // Make the counts and the compacted instances visible to the draws
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+    }
+
+    // Draw the towers that survived culling for a pass, the bound shader must have
+    // useInstancing = true (and useLayerSlots = true for the light pass)
+    void draw(Pass pass) const {
+        if (!ready || towerCount == 0) return;
+        // shadow passes only need positions, plus the layer slot of each pair
+        glBindVertexArray(pass == LightPass ? depthVAO : VAO);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        Renderer::multiDrawArraysIndirect(GL_TRIANGLES, (void*)(pass * sizeof(DrawArraysIndirectCommand)), 1, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+private:
+    struct DrawArraysIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint first;
+        GLuint baseInstance;
+    };
+
+    bool ready = false;
+    Shader* cullShader = nullptr;
+    GLuint towerCount = 0;
+    GLuint towerSSBO = 0;
+    GLuint visibleSSBO = 0;
+    GLuint slotSSBO = 0;
+    GLuint commandBuffer = 0;
+    GLuint VAO = 0;
+    GLuint depthVAO = 0;
+    DrawArraysIndirectCommand resetCommands[PassCount];
+
+    void dispatch(Pass pass, const Frustum* frustums, GLuint frustumCount, bool frustumCulling) {
+        // With culling off plane sets accepting everything, still one per light layer
+        glm::vec4 planes[6 * MAX_FRUSTUMS];
+        if (frustums == nullptr) frustumCount = 1;
+        for (GLuint f = 0; f < frustumCount; ++f)
+            for (int p = 0; p < 6; ++p)
+                planes[6 * f + p] = (frustumCulling && frustums) ? frustums[f].planes[p] : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+        glUniform4fv(glGetUniformLocation(cullShader->ID, "frustumPlanes"), 6 * frustumCount, &planes[0].x);
+        glUniform1ui(glGetUniformLocation(cullShader->ID, "frustumCount"), frustumCount);
+        glUniform1i(glGetUniformLocation(cullShader->ID, "appendPairs"), pass == LightPass);
+        glUniform1ui(glGetUniformLocation(cullShader->ID, "commandIndex"), pass);
+        glDispatchCompute((towerCount + 63) / 64, 1, 1);
+    }
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "frustum.h"
+#include "geometry.h"
+#include "renderer.h"
+#include "shader.h"
+#include "towers.h"
+
+// Hardware occlusion culling with GL_ANY_SAMPLES_PASSED queries on bounding boxes.
+// Towers are grouped into clusters by a coarse XZ grid; each cluster (and every
+// extra object such as the monster) owns a query. Draws are wrapped in
+// glBeginConditionalRender using the query issued the previous frame, so the
+// CPU never waits for a result: the GPU skips the draw if the box was hidden.
+// Boxes are queried at the end of the frame against the full depth buffer.
+// --------------------------------------------------------------------------------
+class OcclusionQueries {
+public:
+    void create(Geometry& geometry, const std::vector<Tower>& towers, float cellSize, Shader* boundsShader, GLuint cubeVAO) {
+        this->boundsShader = boundsShader;
+        this->cubeVAO = cubeVAO;
+
+        // Bucket the towers per grid cell, the map keeps the cells in a stable order
+        std::map<std::pair<int, int>, std::vector<size_t>> cells;
+        for (size_t i = 0; i < towers.size(); ++i) {
+            const glm::vec3& p = towers[i].position;
+            cells[{ static_cast<int>(std::floor(p.x / cellSize)), static_cast<int>(std::floor(p.z / cellSize)) }].push_back(i);
+        }
+
+        std::vector<glm::vec4> instances;
+        instances.reserve(towers.size());
+        for (const auto& cell : cells) {
+            Slot slot;
+            slot.firstInstance = static_cast<GLuint>(instances.size());
+            slot.instanceCount = static_cast<GLsizei>(cell.second.size());
+            glm::vec3 lo(1e30f), hi(-1e30f);
+            for (size_t index : cell.second) {
+                const Tower& tower = towers[index];
+                instances.push_back(glm::vec4(tower.position, tower.height));
+                lo = glm::min(lo, tower.position - towerExtent(tower));
+                hi = glm::max(hi, tower.position + towerExtent(tower));
+            }
+            slot.center = 0.5f * (lo + hi);
+            slot.extent = 0.5f * (hi - lo);
+            glGenQueries(1, &slot.query);
+            slots.push_back(slot);
+        }
+        clusterCount = slots.size();
+
+        glGenBuffers(1, &instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(glm::vec4), instances.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        VAO = geometry.createInstancedLightCube(instanceVBO);
+
+        std::cout << "OCCLUSION LOG: " << towers.size() << " towers grouped into " << clusterCount << " query clusters" << std::endl;
+    }
+
+    // Register an object that is not a tower (ex: the monster), returns its slot
+    size_t addObject() {
+        Slot slot;
+        glGenQueries(1, &slot.query);
+        slots.push_back(slot);
+        return slots.size() - 1;
+    }
+
+    void setBounds(size_t slot, const glm::vec3& center, const glm::vec3& extent) {
+        slots[slot].center = center;
+        slots[slot].extent = extent;
+    }
+
+    // Draw the tower clusters inside the frustum (all when null), each one
+    // conditioned on last frame's query. The bound shader must have useInstancing = true.
+    void drawTowers(const Frustum* frustum) {
+        collectResults();
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        for (size_t i = 0; i < clusterCount; ++i) {
+            Slot& slot = slots[i];
+            slot.inFrustum = frustum == nullptr || frustum->intersectsAABB(slot.center, slot.extent);
+            if (!slot.inFrustum) continue;
+
+            // point the instance attribute at this cluster's range
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(slot.firstInstance * sizeof(glm::vec4)));
+            beginConditional(i);
+            Renderer::drawArraysInstanced(GL_TRIANGLES, 0, 36, slot.instanceCount);
+            endConditional(i);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    // Wrap the draws of one slot, skipped by the GPU if its box was hidden last frame
+    void beginConditional(size_t slot) {
+        if (slots[slot].queryIssued) glBeginConditionalRender(slots[slot].query, GL_QUERY_NO_WAIT);
+    }
+
+    void endConditional(size_t slot) {
+        if (slots[slot].queryIssued) glEndConditionalRender();
+    }
+
+    // Query every box in the frustum against the finished depth buffer (end of the lighting pass).
+    // Boxes containing the camera are never queried, their near faces would be clipped.
+    // A box face can lie exactly on a tower face already in the depth buffer (single tower
+    // clusters, front rows seen face-on), so the boxes pass on equal depth too.
+    void issueQueries(const glm::mat4& viewProjection, const Frustum* frustum, const glm::vec3& cameraPos) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_LEQUAL);
+        glDisable(GL_CULL_FACE);
+
+        boundsShader->use();
+        boundsShader->setMat4("lightSpaceMatrix", viewProjection);
+        boundsShader->setInt("useInstancing", 0);
+        glBindVertexArray(cubeVAO);
+
+        for (size_t i = 0; i < slots.size(); ++i) {
+            Slot& slot = slots[i];
+            bool visibleByFrustum = i < clusterCount ? slot.inFrustum
+                                                     : (frustum == nullptr || frustum->intersectsAABB(slot.center, slot.extent));
+            glm::vec3 d = glm::abs(cameraPos - slot.center) - slot.extent;
+            bool cameraInside = d.x < 1.0f && d.y < 1.0f && d.z < 1.0f;
+            if (!visibleByFrustum || cameraInside) {
+                slot.queryIssued = false;   // draw unconditionally until it is queried again
+                continue;
+            }
+
+            glm::mat4 world = glm::scale(glm::translate(glm::mat4(1.0f), slot.center), 2.0f * slot.extent);
+            boundsShader->setMat4("worldMatrix", world);
+            glBeginQuery(GL_ANY_SAMPLES_PASSED, slot.query);
+            Renderer::drawArrays(GL_TRIANGLES, 0, 36);
+            glEndQuery(GL_ANY_SAMPLES_PASSED);
+            slot.queryIssued = true;
+            slot.resultPending = true;
+        }
+
+        glBindVertexArray(0);
+        glEnable(GL_CULL_FACE);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    }
+
+    // Statistics of the last results that were available, without waiting on the GPU
+    size_t hiddenClusters() const { return lastHiddenClusters; }
+    size_t hiddenTowers() const { return lastHiddenTowers; }
+    size_t hiddenObjects() const { return lastHiddenObjects; }
+
+private:
+    struct Slot {
+        glm::vec3 center{0.0f};
+        glm::vec3 extent{0.0f};
+        GLuint query = 0;
+        GLuint firstInstance = 0;    // towers only
+        GLsizei instanceCount = 0;
+        bool inFrustum = false;
+        bool queryIssued = false;    // a query exists from last frame, draws are conditional
+        bool resultPending = false;  // stats only
+        bool hidden = false;
+    };
+
+    std::vector<Slot> slots;         // tower clusters first, then other objects
+    size_t clusterCount = 0;
+    Shader* boundsShader = nullptr;  // position only shader, ShadowDepth with the camera matrix
+    GLuint cubeVAO = 0;
+    GLuint VAO = 0;
+    GLuint instanceVBO = 0;
+    size_t lastHiddenClusters = 0, lastHiddenTowers = 0, lastHiddenObjects = 0;
+
+    // Read the results that are ready; the GPU does the real skipping on its own
+    void collectResults() {
+        lastHiddenClusters = lastHiddenTowers = lastHiddenObjects = 0;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            Slot& slot = slots[i];
+            if (slot.resultPending) {
+                GLuint available = 0;
+                glGetQueryObjectuiv(slot.query, GL_QUERY_RESULT_AVAILABLE, &available);
+                if (available) {
+                    GLuint anySamples = 0;
+                    glGetQueryObjectuiv(slot.query, GL_QUERY_RESULT, &anySamples);
+                    slot.hidden = anySamples == 0;
+                    slot.resultPending = false;
+                }
+            }
+            if (!slot.queryIssued || !slot.hidden) continue;
+            if (i < clusterCount) {
+                ++lastHiddenClusters;
+                lastHiddenTowers += slot.instanceCount;
+            }
+            else {
+                ++lastHiddenObjects;
+            }
+        }
+    }
+};
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+constexpr int JOB_QUEUE_CAPACITY = 1024;   // jobs per queue, power of two; a full queue runs the job inline
+constexpr int MAX_JOB_QUEUES = 32;         // worker threads + other threads submitting (main, simulation)
+constexpr int JOB_IDLE_SPINS = 64;         // failed steal rounds before a worker goes to sleep
+
+// Counts the jobs of a batch still pending, wait() on it until they are done.
+// Work that depends on a batch simply waits on its counter before starting.
+struct JobCounter {
+    std::atomic<int> pending{ 0 };
+    bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+};
+
+// A job is a plain function pointer + its context, no allocation per job
+struct Job {
+    void (*run)(const void* context, size_t index) = nullptr;
+    const void* context = nullptr;
+    size_t index = 0;
+    JobCounter* counter = nullptr;
+};
+
+// Chase-Lev work-stealing deque with a fixed ring of jobs. Only its owner
+// thread pushes and pops at the bottom (LIFO, the data it just touched is
+// still in cache), any other thread steals from the top (FIFO, the biggest
+// and oldest work). Owner and thieves only race for the last job, settled by
+// a CAS on top. Memory orders follow Le et al., "Correct and Efficient
+// Work-Stealing for Weak Memory Models" (PPoPP 2013).
+// ---------------------------------------------------------------------------
+class JobDeque {
+public:
+    bool push(const Job& job) {
+        int64_t b = mBottom.load(std::memory_order_relaxed);
+        int64_t t = mTop.load(std::memory_order_acquire);
+        if (b - t >= JOB_QUEUE_CAPACITY) return false;
+        mJobs[b & MASK] = job;
+        std::atomic_thread_fence(std::memory_order_release);
+        mBottom.store(b + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool pop(Job& job) {
+        int64_t b = mBottom.load(std::memory_order_relaxed) - 1;
+        mBottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = mTop.load(std::memory_order_relaxed);
+        if (t > b) {   // empty
+            mBottom.store(b + 1, std::memory_order_relaxed);
+            return false;
+        }
+        job = mJobs[b & MASK];
+        if (t == b) {  // the last job, a thief may be taking it too
+            bool won = mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            mBottom.store(b + 1, std::memory_order_relaxed);
+            return won;
+        }
+        return true;
+    }
+
+    bool steal(Job& job) {
+        int64_t t = mTop.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = mBottom.load(std::memory_order_acquire);
+        if (t >= b) return false;
+        // Copied before the CAS: the owner can't reuse this slot before top moves past it
+        job = mJobs[t & MASK];
+        return mTop.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr int64_t MASK = JOB_QUEUE_CAPACITY - 1;
+    alignas(64) std::atomic<int64_t> mTop{ 0 };
+    alignas(64) std::atomic<int64_t> mBottom{ 0 };
+    alignas(64) Job mJobs[JOB_QUEUE_CAPACITY];
+};
+
+// Work-stealing job system: threadCount - 1 worker threads, each with its own
+// deque. A thread that submits work (the main thread, the simulation thread)
+// gets a deque of its own on first use, pushes its jobs there and helps run
+// jobs while it waits, so it is one of the threadCount threads doing the work.
+// Idle workers steal from every deque and sleep once there is nothing left.
+// ---------------------------------------------------------------------------
+class JobSystem {
+public:
+    explicit JobSystem(unsigned int threads = std::max(1u, std::thread::hardware_concurrency()))
+        : mThreadCount(std::max(1u, threads)), mId(nextId()) {
+        mWorkers = std::min<int>(static_cast<int>(mThreadCount) - 1, MAX_JOB_QUEUES / 2);
+        mThreadCount = static_cast<unsigned int>(mWorkers + 1);
+        for (int q = 0; q < MAX_JOB_QUEUES; ++q) mQueues[q].reset(new JobDeque());
+        mQueueCount.store(mWorkers, std::memory_order_relaxed);
+        for (int w = 0; w < mWorkers; ++w)
+            mThreads.emplace_back([this, w] { workerLoop(w); });
+    }
+    ~JobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mRunning.store(false, std::memory_order_relaxed);
+            mEpoch.fetch_add(1, std::memory_order_seq_cst);
+        }
+        mWake.notify_all();
+        for (auto& thread : mThreads) thread.join();
+    }
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Threads doing the work, the calling thread included
+    unsigned int threadCount() const { return mThreadCount; }
+
+    // Queue fn() as one job counted by counter. fn is referenced, not copied:
+    // it has to outlive wait(counter).
+    template <typename Fn>
+    void run(JobCounter& counter, const Fn& fn) {
+        submit(counter, [](const void* context, size_t) { (*static_cast<const Fn*>(context))(); }, &fn, 1);
+    }
+
+    // Run the queued jobs (any of them, not only the counter's) until the counter's are done
+    void wait(JobCounter& counter) {
+        int queue = queueOfThisThread();
+        int idle = 0;
+        while (!counter.done()) {
+            if (runOne(queue)) idle = 0;
+            else if (++idle > JOB_IDLE_SPINS) std::this_thread::yield();
+        }
+    }
+
+    // Split [0, count) into at most threadCount() contiguous ranges of at least
+    // minPerTask items and run fn(taskIndex, begin, end) for each of them. The
+    // calling thread runs the first range, helps with the others and returns
+    // once every range is done, so fn may reference locals.
+    template <typename Fn>
+    void parallelFor(size_t count, size_t minPerTask, const Fn& fn) {
+        if (count == 0) return;
+        size_t tasks = std::min<size_t>(mThreadCount, (count + minPerTask - 1) / std::max<size_t>(1, minPerTask));
+        tasks = std::max<size_t>(1, tasks);
+        size_t perTask = (count + tasks - 1) / tasks;
+        tasks = (count + perTask - 1) / perTask;   // no empty range at the end
+
+        struct Range {
+            const Fn* fn;
+            size_t count, perTask;
+        } range{ &fn, count, perTask };
+        auto runRange = [](const void* context, size_t task) {
+            const Range& r = *static_cast<const Range*>(context);
+            size_t begin = task * r.perTask;
+            (*r.fn)(task, begin, std::min(r.count, begin + r.perTask));
+        };
+
+        if (tasks == 1) {
+            runRange(&range, 0);
+            return;
+        }
+        JobCounter counter;
+        submit(counter, runRange, &range, tasks, 1);
+        runRange(&range, 0);
+        wait(counter);
+    }
+
+private:
+    unsigned int mThreadCount;
+    const uint64_t mId;
+    int mWorkers = 0;
+    std::unique_ptr<JobDeque> mQueues[MAX_JOB_QUEUES];
+    std::atomic<int> mQueueCount{ 0 };       // workers first, then the submitting threads
+    std::vector<std::thread> mThreads;
+
+    // Sleeping workers: pushers bump the epoch, a worker only sleeps while it is unchanged
+    std::atomic<bool> mRunning{ true };
+    std::atomic<uint32_t> mEpoch{ 0 };
+    std::atomic<int> mSleeping{ 0 };
+    std::mutex mSleepMutex;
+    std::condition_variable mWake;
+
+    static uint64_t nextId() {
+        static std::atomic<uint64_t> id{ 0 };
+        return ++id;
+    }
+
+    // The deque of the calling thread, registered on first use; -1 once they are all taken.
+    // A thread remembers its deque in a few systems (the benchmarks make several).
+    struct Registration { uint64_t system = 0; int queue = -1; };
+    static Registration& registration(uint64_t system) {
+        thread_local Registration registrations[4];
+        thread_local unsigned int next = 0;
+        for (auto& r : registrations)
+            if (r.system == system) return r;
+        Registration& r = registrations[next++ % 4];
+        r = { system, -1 };
+        return r;
+    }
+    int queueOfThisThread() {
+        Registration& r = registration(mId);
+        if (r.queue < 0) {
+            int queue = mQueueCount.fetch_add(1, std::memory_order_acq_rel);
+            r.queue = queue < MAX_JOB_QUEUES ? queue : MAX_JOB_QUEUES;
+        }
+        return r.queue < MAX_JOB_QUEUES ? r.queue : -1;
+    }
+
+    // Push jobs [first, last) of one batch and wake the sleeping workers
+    void submit(JobCounter& counter, void (*run)(const void*, size_t), const void* context, size_t last, size_t first = 0) {
+        int queue = queueOfThisThread();
+        counter.pending.fetch_add(static_cast<int>(last - first), std::memory_order_relaxed);
+        for (size_t i = first; i < last; ++i) {
+            Job job{ run, context, i, &counter };
+            if (mWorkers == 0 || queue < 0 || !mQueues[queue]->push(job)) execute(job);
+        }
+        mEpoch.fetch_add(1, std::memory_order_seq_cst);
+        if (mSleeping.load(std::memory_order_seq_cst) > 0) {
+            std::lock_guard<std::mutex> lock(mSleepMutex);
+            mWake.notify_all();
+        }
+    }
+
+    static void execute(const Job& job) {
+        job.run(job.context, job.index);
+        job.counter->pending.fetch_sub(1, std::memory_order_release);
+    }
+
+    // Own deque first, then steal starting from the next one. False if nothing ran.
+    bool runOne(int queue) {
+        Job job;
+        if (queue >= 0 && mQueues[queue]->pop(job)) {
+            execute(job);
+            return true;
+        }
+        int queues = std::min(mQueueCount.load(std::memory_order_acquire), MAX_JOB_QUEUES);
+        for (int i = 1; i <= queues; ++i) {
+            int victim = (std::max(queue, 0) + i) % queues;
+            if (victim != queue && mQueues[victim]->steal(job)) {
+                execute(job);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(int queue) {
+        registration(mId).queue = queue;
+        int idle = 0;
+        while (mRunning.load(std::memory_order_relaxed)) {
+            uint32_t epoch = mEpoch.load(std::memory_order_seq_cst);
+            if (runOne(queue)) {
+                idle = 0;
+                continue;
+            }
+            if (++idle < JOB_IDLE_SPINS) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mSleepMutex);
+            mSleeping.fetch_add(1, std::memory_order_seq_cst);
+            mWake.wait(lock, [&] { return mEpoch.load(std::memory_order_seq_cst) != epoch || !mRunning.load(std::memory_order_relaxed); });
+            mSleeping.fetch_sub(1, std::memory_order_relaxed);
+            idle = 0;
+        }
+    }
+};
+
+// The job system every per-frame task runs on, sized to the hardware threads
+// --------------------------------------------------------------------------
+inline JobSystem& jobSystem() {
+    static JobSystem system;
+    return system;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "frustum.h"
+#include "towers.h"
+
+// How the scene is lit, cycled at runtime with L
+// ----------------------------------------------
+enum class LightingPath {
+    Forward,    // Phong.frag / Monster.frag, the two shadowed lights only
+    Deferred,   // G-buffer + full screen shadowed lights + one volume per point light (deferred.h)
+    Clustered,  // Phong.frag / Monster.frag + the point lights of each fragment's cluster (clustered.h)
+    Count
+};
+
+inline const char* lightingPathName(LightingPath path) {
+    switch (path) {
+        case LightingPath::Forward:   return "Forward";
+        case LightingPath::Deferred:  return "Deferred";
+        case LightingPath::Clustered: return "Clustered";
+        default:                      return "Unknown";
+    }
+}
+
+// Small unshadowed point lights (projectile glows, street lamps) on top of the
+// two orbiting shadowed lights. Two vec4 so the array can be uploaded as is.
+// ---------------------------------------------------------------------------
+struct PointLight {
+    glm::vec4 positionRadius;   // xyz = world position, w = radius where it fades to 0
+    glm::vec4 colorIntensity;   // rgb = color, a = intensity
+};
+
+constexpr int MAX_POINT_LIGHTS = 4096;   // per frame, after frustum culling
+
+constexpr float LAMP_SPACING = 10.0f;
+constexpr float LAMP_HEIGHT = 3.0f;
+constexpr float LAMP_RADIUS = 9.0f;
+constexpr float PROJECTILE_LIGHT_RADIUS = 6.0f;
+constexpr float PROJECTILE_LIGHT_INTENSITY = 4.0f;
+const glm::vec3 PROJECTILE_LIGHT_COLOR(1.0f, 0.35f, 0.2f);
+
+inline PointLight makePointLight(const glm::vec3& position, float radius, const glm::vec3& color, float intensity) {
+    return { glm::vec4(position, radius), glm::vec4(color, intensity) };
+}
+
+// Street lamps on a regular grid over the city, skipping the spots inside or
+// right next to a tower. Positions are hashed into a coarse grid of the tower
+// footprints so this stays linear in the tower count.
+// -----------------------------------------------------------------------------
+inline void generateStreetLamps(const std::vector<Tower>& towers, float halfExtent, std::vector<PointLight>& lamps) {
+    int cells = std::max(1, static_cast<int>(std::ceil(2.0f * halfExtent / LAMP_SPACING)));
+    std::vector<uint8_t> blocked(static_cast<size_t>(cells) * cells, 0);
+    auto cellOf = [&](float v) { return static_cast<int>(std::floor((v + halfExtent) / LAMP_SPACING + 0.5f)); };
+    for (const auto& tower : towers) {
+        int x = cellOf(tower.position.x), z = cellOf(tower.position.z);
+        glm::vec2 lamp(x * LAMP_SPACING - halfExtent, z * LAMP_SPACING - halfExtent);
+        if (x < 0 || z < 0 || x >= cells || z >= cells) continue;
+        glm::vec2 d = glm::abs(glm::vec2(tower.position.x, tower.position.z) - lamp);
+        if (std::max(d.x, d.y) < TOWER_WIDTH) blocked[static_cast<size_t>(z) * cells + x] = 1;
+    }
+    for (int z = 0; z < cells; ++z)
+        for (int x = 0; x < cells; ++x) {
+            if (blocked[static_cast<size_t>(z) * cells + x]) continue;
+            glm::vec3 position(x * LAMP_SPACING - halfExtent, LAMP_HEIGHT, z * LAMP_SPACING - halfExtent);
+            lamps.push_back(makePointLight(position, LAMP_RADIUS, glm::vec3(1.0f, 0.8f, 0.5f), 6.0f));
+        }
+}
+
+// Extra lights scattered over the city at random heights (--lights N), for
+// testing how the lighting paths scale
+// -------------------------------------------------------------------------
+inline void generateRandomLights(int count, float halfExtent, std::vector<PointLight>& lights) {
+    for (int i = 0; i < count; ++i) {
+        float x = (static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f) * halfExtent;
+        float z = (static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f) * halfExtent;
+        float y = 0.5f + static_cast<float>(rand()) / RAND_MAX * 6.0f;
+        glm::vec3 color(static_cast<float>(rand()) / RAND_MAX, static_cast<float>(rand()) / RAND_MAX, static_cast<float>(rand()) / RAND_MAX);
+        lights.push_back(makePointLight(glm::vec3(x, y, z), 5.0f, glm::normalize(color + glm::vec3(0.2f)), 4.0f));
+    }
+}
+
+// Append the lights whose sphere touches the frustum, up to MAX_POINT_LIGHTS
+// ---------------------------------------------------------------------------
+inline void cullPointLights(const Frustum& frustum, const PointLight* lights, size_t count, std::vector<PointLight>& visible) {
+    for (size_t i = 0; i < count; ++i) {
+        const PointLight& light = lights[i];
+        if (visible.size() >= static_cast<size_t>(MAX_POINT_LIGHTS)) return;
+        glm::vec3 center(light.positionRadius);
+        if (frustum.intersectsAABB(center, glm::vec3(light.positionRadius.w))) visible.push_back(light);
+    }
+}
@@ -0,0 +1,220 @@
+#pragma once
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "flowfield.h"
+#include "geometry.h"
+#include "parallel.h"
+#include "renderer.h"
+#include "spatialgrid.h"
+
+constexpr size_t MAX_MONSTERS = 4096;                 // pool capacity, --monsters is clamped to it
+constexpr float MONSTER_SCALE = 0.5f;                 // Stone.obj drawn at half size
+constexpr float MONSTER_RADIUS_LOCAL = 2.0f;          // fits the Stone.obj bounds
+constexpr float MONSTER_RADIUS = MONSTER_RADIUS_LOCAL * MONSTER_SCALE;
+constexpr float MONSTER_GRID_CELL_SIZE = 4.0f;        // broadphase cells, a bit more than a monster across
+constexpr float MONSTER_SPEED = 1.2f;                 // m/s, a bit faster than the camera walks
+constexpr float MONSTER_STOP_DISTANCE = 3.0f;         // they stop this far from their target
+
+// Every monster of the wave, as a structure of arrays with a fixed capacity
+// like ProjectilePool. Monsters are never removed: a monster that gets hit
+// is moved to a new spawn point and keeps its index. They walk along a flow
+// field, the position of the step before is kept for drawing in between.
+// ---------------------------------------------------------------------------
+class MonsterPool {
+public:
+    explicit MonsterPool(size_t capacity)
+        : mCapacity(capacity), mX(capacity), mY(capacity), mZ(capacity)
+        , mPrevX(capacity), mPrevY(capacity), mPrevZ(capacity), mVelX(capacity), mVelZ(capacity) {}
+
+    size_t size() const { return mCount; }
+    size_t capacity() const { return mCapacity; }
+    bool empty() const { return mCount == 0; }
+
+    // O(1), false when the pool is full
+    bool spawn(const glm::vec3& position) {
+        if (mCount == mCapacity) return false;
+        setPosition(mCount++, position);
+        return true;
+    }
+
+    // Teleport (spawn, respawn): no motion to draw in between
+    void setPosition(size_t i, const glm::vec3& position) {
+        mX[i] = mPrevX[i] = position.x;
+        mY[i] = mPrevY[i] = position.y;
+        mZ[i] = mPrevZ[i] = position.z;
+        mVelX[i] = mVelZ[i] = 0.0f;
+    }
+    glm::vec3 position(size_t i) const { return glm::vec3(mX[i], mY[i], mZ[i]); }
+    glm::vec3 prevPosition(size_t i) const { return glm::vec3(mPrevX[i], mPrevY[i], mPrevZ[i]); }
+    // Between the previous step (alpha 0) and the last one (alpha 1), for drawing
+    glm::vec3 interpolatedPosition(size_t i, float alpha) const { return glm::mix(prevPosition(i), position(i), alpha); }
+    glm::vec3 velocity(size_t i) const { return glm::vec3(mVelX[i], 0.0f, mVelZ[i]); }
+
+    // One step of walking: every monster heads where the flow field points
+    // (its target is the field's), stops MONSTER_STOP_DISTANCE from the
+    // target and slides along a blocked cell instead of walking into it.
+    // Monsters are independent, ranges of them run on the job system.
+    void walk(const FlowField& field, const glm::vec3& target, float dt, float speed = MONSTER_SPEED) {
+        parallelFor(mCount, 256, [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                glm::vec3 position = this->position(i);
+                mPrevX[i] = position.x; mPrevY[i] = position.y; mPrevZ[i] = position.z;
+                glm::vec2 toTarget(target.x - position.x, target.z - position.z);
+                glm::vec3 velocity(0.0f);
+                if (glm::dot(toTarget, toTarget) > MONSTER_STOP_DISTANCE * MONSTER_STOP_DISTANCE)
+                    velocity = field.direction(position) * speed;
+                glm::vec3 next = position + velocity * dt;
+                if (!field.walkable(next) && field.walkable(position)) {
+                    glm::vec3 alongX(next.x, position.y, position.z), alongZ(position.x, position.y, next.z);
+                    next = field.walkable(alongX) ? alongX : field.walkable(alongZ) ? alongZ : position;
+                    velocity = (next - position) / dt;
+                }
+                mX[i] = next.x; mZ[i] = next.z;
+                mVelX[i] = velocity.x; mVelZ[i] = velocity.z;
+            }
+        });
+    }
+
+    // Rebuild the broadphase over the monsters' current positions
+    void buildGrid(SphereGrid& grid) const {
+        grid.build(mX.data(), mY.data(), mZ.data(), mCount, MONSTER_RADIUS, MONSTER_GRID_CELL_SIZE);
+    }
+
+private:
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+    std::vector<float> mX, mY, mZ;
+    std::vector<float> mPrevX, mPrevY, mPrevZ;
+    std::vector<float> mVelX, mVelZ;   // m/s over the ground in the last step
+};
+
+// The monsters as instances of the Stone.obj VAOs: position + scale. The lit
+// VAO and the positions only VAO read two separate streamed buffers, so the
+// camera pass draws the monsters in the view and the shadow pass the casters,
+// each with one instanced call (casters as one (monster, layer) pair per
+// shadow layer they reach). The vertex shaders build the world matrix
+// (useInstancing in Monster.vert, useMonsterInstancing in ShadowLayered.vert).
+// ---------------------------------------------------------------------------
+class MonsterInstances {
+public:
+    // maxLayers: shadow layers a caster can be drawn into
+    void create(GLuint modelVAO, GLuint depthVAO, int vertexCount, size_t capacity, size_t maxLayers) {
+        mCapacity = capacity;
+        mCasterCapacity = capacity * maxLayers;
+        mVertexCount = vertexCount;
+        mStaging.reserve(mCasterCapacity);
+        mVisible.create(modelVAO, capacity);
+        mCasters.create(depthVAO, mCasterCapacity);
+        glGenBuffers(1, &mSlotVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mSlotVBO);
+        glBufferData(GL_ARRAY_BUFFER, mCasterCapacity, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        Geometry::addLayerSlots(depthVAO, mSlotVBO);
+    }
+
+    // Stream the monsters for which keep(position, radius) is true for the
+    // camera pass, placed `alpha` of the way between their last two steps
+    template <typename Fn>
+    void uploadVisible(const MonsterPool& pool, Fn&& keep, float alpha = 1.0f) {
+        mStaging.clear();
+        glm::vec3 lo(1e30f), hi(-1e30f);
+        for (size_t i = 0; i < pool.size() && mStaging.size() < mCapacity; ++i) {
+            glm::vec3 position = pool.interpolatedPosition(i, alpha);
+            if (!keep(position, MONSTER_RADIUS)) continue;
+            mStaging.push_back(glm::vec4(position, MONSTER_SCALE));
+            lo = glm::min(lo, position - glm::vec3(MONSTER_RADIUS));
+            hi = glm::max(hi, position + glm::vec3(MONSTER_RADIUS));
+        }
+        mVisible.count = static_cast<GLsizei>(mStaging.size());
+        mVisibleMin = mVisible.count ? lo : glm::vec3(0.0f);
+        mVisibleMax = mVisible.count ? hi : glm::vec3(0.0f);
+        if (mVisible.count == 0) return;
+
+        // Orphan last frame's contents so we don't wait on the draws still reading them
+        glBindBuffer(GL_ARRAY_BUFFER, mVisible.vbo);
+        glBufferData(GL_ARRAY_BUFFER, mCapacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mStaging.size() * sizeof(glm::vec4), mStaging.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Stream the shadow casters, one (monster, layer) pair per bit of
+    // layersOf(position, radius): the layer slots the monster reaches
+    template <typename Fn>
+    void uploadCasters(const MonsterPool& pool, Fn&& layersOf, float alpha = 1.0f) {
+        mStaging.clear();
+        mSlots.clear();
+        for (size_t i = 0; i < pool.size(); ++i) {
+            glm::vec3 position = pool.interpolatedPosition(i, alpha);
+            uint32_t layers = layersOf(position, MONSTER_RADIUS);
+            for (uint8_t slot = 0; layers && mStaging.size() < mCasterCapacity; ++slot, layers >>= 1) {
+                if (!(layers & 1)) continue;
+                mStaging.push_back(glm::vec4(position, MONSTER_SCALE));
+                mSlots.push_back(slot);
+            }
+        }
+        mCasters.count = static_cast<GLsizei>(mStaging.size());
+        if (mCasters.count == 0) return;
+
+        glBindBuffer(GL_ARRAY_BUFFER, mCasters.vbo);
+        glBufferData(GL_ARRAY_BUFFER, mCasterCapacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mStaging.size() * sizeof(glm::vec4), mStaging.data());
+        glBindBuffer(GL_ARRAY_BUFFER, mSlotVBO);
+        glBufferData(GL_ARRAY_BUFFER, mCasterCapacity, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mSlots.size(), mSlots.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // The bound shader must have its instancing flag set, and useLayerSlots
+    // for the casters
+    void drawVisible() const { draw(mVisible); }
+    void drawCasters() const { draw(mCasters); }
+
+    GLsizei visibleCount() const { return mVisible.count; }
+    GLsizei casterCount() const { return mCasters.count; }   // (monster, layer) pairs
+
+    // Box around the visible monsters (center, half extent), for the occlusion query
+    glm::vec3 visibleCenter() const { return 0.5f * (mVisibleMax + mVisibleMin); }
+    glm::vec3 visibleExtent() const { return 0.5f * (mVisibleMax - mVisibleMin); }
+
+private:
+    struct Stream {
+        GLuint vao = 0;
+        GLuint vbo = 0;
+        GLsizei count = 0;
+
+        void create(GLuint modelVAO, size_t capacity) {
+            vao = modelVAO;
+            glGenBuffers(1, &vbo);
+            glBindBuffer(GL_ARRAY_BUFFER, vbo);
+            glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+            glBindVertexArray(vao);
+            glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), (void*)0);
+            glEnableVertexAttribArray(3);
+            glVertexAttribDivisor(3, 1);
+            glBindVertexArray(0);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    };
+
+    size_t mCapacity = 0;
+    size_t mCasterCapacity = 0;           // pairs
+    int mVertexCount = 0;
+    Stream mVisible, mCasters;
+    GLuint mSlotVBO = 0;
+    std::vector<glm::vec4> mStaging;
+    std::vector<uint8_t> mSlots;          // layer slot of each caster pair
+    glm::vec3 mVisibleMin{ 0.0f }, mVisibleMax{ 0.0f };
+
+    void draw(const Stream& stream) const {
+        if (stream.count == 0) return;
+        glBindVertexArray(stream.vao);
+        Renderer::drawArraysInstanced(GL_TRIANGLES, 0, mVertexCount, stream.count);
+        glBindVertexArray(0);
+    }
+};
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+#include "frustum.h"
+#include "parallel.h"
+
+// Software occlusion culling: the nearest boxes are rasterized as occluders
+// into a small CPU depth buffer, then every other box's screen rectangle is
+// tested against it. Rasterization is split into row bands and the tests into
+// index ranges, both run on worker threads. Works for perspective and ortho
+// (light) matrices. Depth is stored as NDC z remapped to [0, 1], 1 = far.
+// ---------------------------------------------------------------------------
+class SoftwareOcclusion {
+public:
+    static constexpr int WIDTH = 256;            // multiple of 4 for the SSE loops
+    static constexpr int HEIGHT = 192;
+    static constexpr size_t MAX_OCCLUDERS = 32;
+
+    SoftwareOcclusion() : depth(WIDTH * HEIGHT, 1.0f) {}
+
+    // Remove the occluded boxes from visible (in place, order is kept)
+    // returns how many boxes were removed
+    size_t cull(const glm::mat4& viewProjection, const AABBList& boxes, std::vector<uint32_t>& visible) {
+        if (visible.size() <= 1) return 0;
+        this->viewProjection = viewProjection;
+
+        selectOccluders(boxes, visible);
+        buildTriangles(boxes);
+
+        // Rasterize the occluders, one band of rows per task
+        parallelFor(HEIGHT, 16, [&](size_t, size_t y0, size_t y1) {
+            std::fill(depth.begin() + y0 * WIDTH, depth.begin() + y1 * WIDTH, 1.0f);
+            for (const auto& tri : triangles)
+                rasterizeTriangle(tri, static_cast<int>(y0), static_cast<int>(y1));
+        });
+
+        // Test every candidate, each task keeps its own output so the order is kept
+        size_t tasks = workerCount();
+        taskResults.resize(tasks);
+        for (auto& result : taskResults) result.clear();
+        parallelFor(visible.size(), 256, [&](size_t task, size_t begin, size_t end) {
+            auto& out = taskResults[task];
+            for (size_t i = begin; i < end; ++i)
+                if (isBoxVisible(boxes, visible[i])) out.push_back(visible[i]);
+        });
+
+        size_t before = visible.size();
+        visible.clear();
+        for (const auto& result : taskResults)
+            visible.insert(visible.end(), result.begin(), result.end());
+        return before - visible.size();
+    }
+
+    size_t occluderCount() const { return occluders.size(); }
+
+private:
+    struct ScreenTriangle {
+        glm::vec3 v[3];   // pixel x, pixel y, depth [0, 1]
+    };
+
+    glm::mat4 viewProjection;
+    std::vector<float> depth;
+    std::vector<uint32_t> occluders;
+    std::vector<ScreenTriangle> triangles;
+    std::vector<std::vector<uint32_t>> taskResults;
+
+    static void boxCorners(const AABBList& boxes, uint32_t index, glm::vec3 corners[8]) {
+        glm::vec3 c(boxes.centerX[index], boxes.centerY[index], boxes.centerZ[index]);
+        glm::vec3 e(boxes.extentX[index], boxes.extentY[index], boxes.extentZ[index]);
+        for (int i = 0; i < 8; ++i)
+            corners[i] = c + glm::vec3((i & 1) ? e.x : -e.x, (i & 2) ? e.y : -e.y, (i & 4) ? e.z : -e.z);
+    }
+
+    // Clip space -> (pixel x, pixel y, depth), false if the point is behind the eye
+    bool project(const glm::vec3& p, glm::vec3& out) const {
+        glm::vec4 clip = viewProjection * glm::vec4(p, 1.0f);
+        if (clip.w <= 1e-4f) return false;
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        out = glm::vec3((ndc.x * 0.5f + 0.5f) * WIDTH, (ndc.y * 0.5f + 0.5f) * HEIGHT, ndc.z * 0.5f + 0.5f);
+        return true;
+    }
+
+    // The nearest candidates make the best occluders
+    void selectOccluders(const AABBList& boxes, const std::vector<uint32_t>& visible) {
+        occluders.assign(visible.begin(), visible.end());
+        auto distance = [&](uint32_t index) {
+            glm::vec4 clip = viewProjection * glm::vec4(boxes.centerX[index], boxes.centerY[index], boxes.centerZ[index], 1.0f);
+            return clip.z / std::max(clip.w, 1e-4f);
+        };
+        size_t count = std::min(MAX_OCCLUDERS, occluders.size());
+        std::partial_sort(occluders.begin(), occluders.begin() + count, occluders.end(),
+                          [&](uint32_t a, uint32_t b) { return distance(a) < distance(b); });
+        occluders.resize(count);
+    }
+
+    // 12 front facing triangles per occluder box, boxes crossing the near plane are skipped
+    void buildTriangles(const AABBList& boxes) {
+        // corner index = x | y << 1 | z << 2, counter-clockwise seen from outside
+        static const int faces[6][4] = {
+            { 4, 5, 7, 6 }, { 1, 0, 2, 3 },   // +Z, -Z
+            { 5, 1, 3, 7 }, { 0, 4, 6, 2 },   // +X, -X
+            { 6, 7, 3, 2 }, { 0, 1, 5, 4 },   // +Y, -Y
+        };
+        triangles.clear();
+        for (uint32_t index : occluders) {
+            glm::vec3 corners[8], screen[8];
+            boxCorners(boxes, index, corners);
+            bool inFront = true;
+            for (int i = 0; i < 8 && inFront; ++i) inFront = project(corners[i], screen[i]);
+            if (!inFront) continue;
+
+            for (const auto& f : faces) {
+                ScreenTriangle a = { { screen[f[0]], screen[f[1]], screen[f[2]] } };
+                ScreenTriangle b = { { screen[f[0]], screen[f[2]], screen[f[3]] } };
+                for (const auto& tri : { a, b }) {
+                    float area = (tri.v[1].x - tri.v[0].x) * (tri.v[2].y - tri.v[0].y)
+                               - (tri.v[2].x - tri.v[0].x) * (tri.v[1].y - tri.v[0].y);
+                    if (area > 0.0f) triangles.push_back(tri);   // back faces are hidden by the front ones
+                }
+            }
+        }
+    }
+
+    // Edge function rasterizer limited to rows [rowBegin, rowEnd), 4 pixels per step
+    void rasterizeTriangle(const ScreenTriangle& tri, int rowBegin, int rowEnd) {
+        const glm::vec3& a = tri.v[0];
+        const glm::vec3& b = tri.v[1];
+        const glm::vec3& c = tri.v[2];
+
+        int minX = std::max(0, static_cast<int>(std::floor(std::min({ a.x, b.x, c.x }))));
+        int maxX = std::min(WIDTH - 1, static_cast<int>(std::ceil(std::max({ a.x, b.x, c.x }))));
+        int minY = std::max(rowBegin, static_cast<int>(std::floor(std::min({ a.y, b.y, c.y }))));
+        int maxY = std::min(rowEnd - 1, static_cast<int>(std::ceil(std::max({ a.y, b.y, c.y }))));
+        if (minX > maxX || minY > maxY) return;
+        minX &= ~3;
+
+        // e_i(p) = A_i * x + B_i * y + C_i, positive inside; w_i = e_i / area weighs the vertex opposite edge i
+        float area = (b.x - a.x) * (c.y - a.y) - (c.x - a.x) * (b.y - a.y);
+        float inv = 1.0f / area;
+        float A0 = (b.y - c.y) * inv, B0 = (c.x - b.x) * inv, C0 = (b.x * c.y - c.x * b.y) * inv;
+        float A1 = (c.y - a.y) * inv, B1 = (a.x - c.x) * inv, C1 = (c.x * a.y - a.x * c.y) * inv;
+        float A2 = (a.y - b.y) * inv, B2 = (b.x - a.x) * inv, C2 = (a.x * b.y - b.x * a.y) * inv;
+        // depth as a plane in screen space: z = zA * x + zB * y + zC
+        float zA = A0 * a.z + A1 * b.z + A2 * c.z;
+        float zB = B0 * a.z + B1 * b.z + B2 * c.z;
+        float zC = C0 * a.z + C1 * b.z + C2 * c.z;
+
+        for (int y = minY; y <= maxY; ++y) {
+            float py = y + 0.5f;
+            float* row = &depth[y * WIDTH];
+#if defined(__SSE2__) || defined(_M_X64)
+            const __m128 zero = _mm_setzero_ps();
+            const __m128 lane = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+            for (int x = minX; x <= maxX; x += 4) {
+                __m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), lane);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A0), px), _mm_set1_ps(B0 * py + C0));
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A1), px), _mm_set1_ps(B1 * py + C1));
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(A2), px), _mm_set1_ps(B2 * py + C2));
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+                if (_mm_movemask_ps(inside) == 0) continue;
+
+                __m128 z = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(zA), px), _mm_set1_ps(zB * py + zC));
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 nearer = _mm_min_ps(old, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+            }
+#else
+            for (int x = minX; x <= maxX; ++x) {
+                float px = x + 0.5f;
+                if (A0 * px + B0 * py + C0 < 0.0f || A1 * px + B1 * py + C1 < 0.0f || A2 * px + B2 * py + C2 < 0.0f) continue;
+                row[x] = std::min(row[x], zA * px + zB * py + zC);
+            }
+#endif
+        }
+    }
+
+    // Conservative: visible if any depth under the box's screen rectangle is at or behind its nearest point
+    bool isBoxVisible(const AABBList& boxes, uint32_t index) const {
+        glm::vec3 corners[8];
+        boxCorners(boxes, index, corners);
+        glm::vec3 lo(1e30f), hi(-1e30f);
+        for (const auto& corner : corners) {
+            glm::vec3 s;
+            if (!project(corner, s)) return true;
+            lo = glm::min(lo, s);
+            hi = glm::max(hi, s);
+        }
+
+        int x0 = std::max(0, static_cast<int>(std::floor(lo.x)));
+        int x1 = std::min(WIDTH - 1, static_cast<int>(std::ceil(hi.x)));
+        int y0 = std::max(0, static_cast<int>(std::floor(lo.y)));
+        int y1 = std::min(HEIGHT - 1, static_cast<int>(std::ceil(hi.y)));
+        if (x0 > x1 || y0 > y1) return true;   // let the frustum test decide
+
+        float nearest = lo.z;
+        for (int y = y0; y <= y1; ++y) {
+            const float* row = &depth[y * WIDTH];
+            int x = x0;
+#if defined(__SSE2__) || defined(_M_X64)
+            const __m128 boxDepth = _mm_set1_ps(nearest);
+            for (; x + 3 <= x1; x += 4)
+                if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), boxDepth)) != 0) return true;
+#endif
+            for (; x <= x1; ++x)
+                if (row[x] >= nearest) return true;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+
+#include "jobs.h"
+
+// Number of threads used for per-frame CPU work (including the calling thread)
+// ----------------------------------------------------------------------------
+inline unsigned int workerCount() {
+    return jobSystem().threadCount();
+}
+
+// Split [0, count) into at most workerCount() contiguous ranges of at least
+// minPerTask items and run fn(taskIndex, begin, end) for each of them on the
+// job system (jobs.h). The calling thread runs the first range and returns
+// once every range is done.
+// -------------------------------------------------------------------------------
+template <typename Fn>
+inline void parallelFor(size_t count, size_t minPerTask, const Fn& fn) {
+    jobSystem().parallelFor(count, minPerTask, fn);
+}
@@ -1,55 +1,427 @@
 #pragma once
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
 #include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "frustum.h"   // CullKernel, bestCullKernel(), <immintrin.h>
+#include "geometry.h"
+#include "renderer.h"
+#include "spatialgrid.h"
+
+constexpr size_t MAX_PROJECTILES = 4096;            // pool capacity in the game
+constexpr float PROJECTILE_MAX_DISTANCE = 800.0f;   // culled once this far from the origin
+constexpr float PROJECTILE_LENGTH = 3.0f;           // the unit cube stretched along the direction
+constexpr float PROJECTILE_WIDTH = 0.025f;
+constexpr size_t PROJECTILE_STEP_WORDS_PER_TASK = 64;     // 4096 projectiles per job for the kernels
+constexpr size_t PROJECTILE_COLLIDE_WORDS_PER_TASK = 4;   // 256 per job for the grid walks
+
+// Segment–sphere intersection (finite beam)
+// -----------------------------------------
+inline bool segmentHitsSphere(const glm::vec3& A, const glm::vec3& B,
+                              const glm::vec3& C, float R)
+{
+    glm::vec3 AB = B - A;
+    float ab2 = glm::dot(AB, AB);
+    if (ab2 == 0.0f) return glm::dot(C - A, C - A) <= R*R;
+    float t = glm::dot(C - A, AB) / ab2;
+    t = glm::clamp(t, 0.0f, 1.0f);
+    glm::vec3 closest = A + t * AB;
+    glm::vec3 d = C - closest;
+    return glm::dot(d, d) <= R*R;
+}
+
+// Every projectile in flight, as a structure of arrays with a fixed capacity:
+// the arrays are allocated once, spawning appends at the end and removing
+// moves the last projectile into the hole (swap and pop), so the live ones
+// stay packed in [0, size()) and nothing is allocated while playing.
+// ---------------------------------------------------------------------------
+class ProjectilePool {
+public:
+    explicit ProjectilePool(size_t capacity)
+        : mCapacity(capacity)
+        , mX(capacity), mY(capacity), mZ(capacity)
+        , mPrevX(capacity), mPrevY(capacity), mPrevZ(capacity)
+        , mVelX(capacity), mVelY(capacity), mVelZ(capacity)
+        , mAge(capacity), mHitTarget(capacity)
+        , mHitMask(capacity / 64 + 1), mDeadMask(capacity / 64 + 1) {}
+
+    size_t size() const { return mCount; }
+    size_t capacity() const { return mCapacity; }
+    bool empty() const { return mCount == 0; }
+    void clear() { mCount = 0; }
+
+    // O(1), false when the pool is full
+    bool spawn(const glm::vec3& position, const glm::vec3& velocity) {
+        if (mCount == mCapacity) return false;
+        size_t i = mCount++;
+        mX[i] = mPrevX[i] = position.x;
+        mY[i] = mPrevY[i] = position.y;
+        mZ[i] = mPrevZ[i] = position.z;
+        mVelX[i] = velocity.x;
+        mVelY[i] = velocity.y;
+        mVelZ[i] = velocity.z;
+        mAge[i] = 0.0f;
+        return true;
+    }
+
+    // O(1), the last projectile takes index i (the order is not kept)
+    void remove(size_t i) {
+        size_t last = --mCount;
+        mX[i] = mX[last]; mY[i] = mY[last]; mZ[i] = mZ[last];
+        mPrevX[i] = mPrevX[last]; mPrevY[i] = mPrevY[last]; mPrevZ[i] = mPrevZ[last];
+        mVelX[i] = mVelX[last]; mVelY[i] = mVelY[last]; mVelZ[i] = mVelZ[last];
+        mAge[i] = mAge[last];
+    }
+
+    // One simulation step, no GL: integrate every projectile, test the segment
+    // it just covered against the target sphere and flag the ones past
+    // PROJECTILE_MAX_DISTANCE. The kernel only writes one hit bit and one dead
+    // bit per projectile, the dead ones are then removed from the highest index
+    // down so every projectile moved into a hole is already done. Kernels that
+    // were not compiled in fall back to the next narrower one. With obstacles,
+    // the segments of the projectiles still alive are walked through the grid
+    // and the ones that run into a box die there too. The kernels and the
+    // grid walks run on the job system in ranges of whole mask words, so no
+    // two jobs write the same word. Returns the hits.
+    // --------------------------------------------------------------------------
+    size_t simulate(float dt, const glm::vec3& target, float radius, CullKernel kernel = bestCullKernel(),
+                    const SpatialGrid* obstacles = nullptr) {
+        size_t words = step({ dt, target, radius * radius, PROJECTILE_MAX_DISTANCE * PROJECTILE_MAX_DISTANCE }, kernel);
+        mObstacleHits = obstacles ? collide(obstacles, nullptr, nullptr) : 0;
+        return removeDead(words);
+    }
+
+    // Same step against many targets (the monsters): the kernels only move and
+    // range cull, then each segment left is paired with the targets near it
+    // through the sphere grid and walked through the obstacles, the first one
+    // it reaches stops it. The index of the target of every hit is appended to
+    // targetHits (a target hit by two projectiles is there twice).
+    // ------------------------------------------------------------------------
+    size_t simulate(float dt, const SphereGrid& targets, std::vector<uint32_t>& targetHits,
+                    const SpatialGrid* obstacles = nullptr, CullKernel kernel = bestCullKernel()) {
+        size_t words = step({ dt, glm::vec3(0.0f), -1.0f, PROJECTILE_MAX_DISTANCE * PROJECTILE_MAX_DISTANCE }, kernel);
+        mObstacleHits = collide(obstacles, &targets, &targetHits);
+        return removeDead(words);
+    }
 
-class Projectile {
-    public:
-        Projectile(const glm::vec3& position, const glm::vec3& velocity, GLuint shaderProgram)
-            : mWorldMatrixLocation(glGetUniformLocation(shaderProgram, "worldMatrix"))
-            , mPosition(position)
-            , mPrevPosition(position)
-            , mVelocity(velocity) {}
-    
-        void Update(float dt) {
-            mPrevPosition = mPosition;        // remember last frame
-            mPosition += mVelocity * dt;      // integrate
+    glm::vec3 position(size_t i) const { return glm::vec3(mX[i], mY[i], mZ[i]); }
+    glm::vec3 prevPosition(size_t i) const { return glm::vec3(mPrevX[i], mPrevY[i], mPrevZ[i]); }
+    // Between the previous step (alpha 0) and the last one (alpha 1), for drawing
+    glm::vec3 interpolatedPosition(size_t i, float alpha) const { return glm::mix(prevPosition(i), position(i), alpha); }
+    glm::vec3 velocity(size_t i) const { return glm::vec3(mVelX[i], mVelY[i], mVelZ[i]); }
+    float age(size_t i) const { return mAge[i]; }
+    bool isMoving(size_t i) const { return mVelX[i] != 0.0f || mVelY[i] != 0.0f || mVelZ[i] != 0.0f; }
+    size_t obstacleHits() const { return mObstacleHits; }   // stopped by an obstacle in the last simulate()
+
+private:
+    struct StepParams {
+        float dt;
+        glm::vec3 target;
+        float radius2;
+        float maxDistance2;
+    };
+
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+    std::vector<float> mX, mY, mZ;
+    std::vector<float> mPrevX, mPrevY, mPrevZ;
+    std::vector<float> mVelX, mVelY, mVelZ;
+    std::vector<float> mAge;   // seconds since spawned
+    std::vector<uint32_t> mHitTarget;            // target hit by each projectile, in collide()
+    std::vector<uint64_t> mHitMask, mDeadMask;   // one bit per projectile, set by the kernels
+    size_t mObstacleHits = 0;
+
+    void mark(size_t i, bool hit, bool dead) {
+        mHitMask[i / 64] |= uint64_t(hit) << (i % 64);
+        mDeadMask[i / 64] |= uint64_t(dead) << (i % 64);
+    }
+
+    // Run the kernel over every projectile, returns the mask words in use
+    size_t step(const StepParams& params, CullKernel kernel) {
+        size_t words = mCount / 64 + 1;
+        std::fill(mHitMask.begin(), mHitMask.begin() + words, 0);
+        std::fill(mDeadMask.begin(), mDeadMask.begin() + words, 0);
+        parallelFor(words, PROJECTILE_STEP_WORDS_PER_TASK, [&](size_t, size_t firstWord, size_t lastWord) {
+            size_t first = firstWord * 64, last = std::min(mCount, lastWord * 64);
+            switch (kernel) {
+#if defined(__AVX2__)
+                case CullKernel::AVX2:
+                    stepScalar(params, stepAVX2(params, first, last), last);
+                    break;
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#if !defined(__AVX2__)
+                case CullKernel::AVX2:
+#endif
+                case CullKernel::SSE:
+                    stepScalar(params, stepSSE(params, first, last), last);
+                    break;
+#endif
+                default:
+                    stepScalar(params, first, last);
+                    break;
+            }
+        });
+        return words;
+    }
+
+    // Count the hits and remove the dead, highest index first
+    size_t removeDead(size_t words) {
+        size_t hits = 0;
+        for (size_t w = words; w-- > 0;) {
+            uint64_t dead = mDeadMask[w];
+            for (uint64_t hit = mHitMask[w]; hit; hit &= hit - 1) ++hits;
+            if (!dead) continue;
+            for (int bit = 63; bit >= 0; --bit)
+                if (dead >> bit & 1) remove(w * 64 + bit);
         }
-    
-        void Draw() const {
-            // Guard against zero velocity (no direction)
-            float vlen2 = glm::dot(mVelocity, mVelocity);
-            if (vlen2 == 0.0f) return;
-    
-            glm::vec3 dir = glm::normalize(mVelocity);
-            glm::vec3 up  = std::abs(glm::dot(dir, glm::vec3(0,1,0))) > 0.99f
-                            ? glm::vec3(0,0,1) : glm::vec3(0,1,0);
-            glm::vec3 right = glm::normalize(glm::cross(up, dir));
-            glm::vec3 newUp = glm::cross(dir, right);
-    
-            glm::mat4 rotation = glm::mat4(
-                glm::vec4(right, 0.0f),   // column 0
-                glm::vec4(newUp, 0.0f),   // column 1
-                glm::vec4(dir,   0.0f),   // column 2
-                glm::vec4(0,0,0,1)        // column 3
-            );
-            glm::mat4 scale  = glm::scale(glm::mat4(1.0f), glm::vec3(0.025f, 0.025f, 3.0f));
-            glm::mat4 world  = glm::translate(glm::mat4(1.0f), mPosition) * rotation * scale;
-    
-            glUniformMatrix4fv(mWorldMatrixLocation, 1, GL_FALSE, &world[0][0]);
-            glDrawArrays(GL_TRIANGLES, 0, 36);
+        return hits;
+    }
+
+    // Grid queries for every segment the kernels left alive: the first target
+    // or obstacle box along it kills it. The target hits are appended in
+    // projectile order. Returns how many obstacles stopped.
+    size_t collide(const SpatialGrid* obstacles, const SphereGrid* targets, std::vector<uint32_t>* targetHits) {
+        size_t stopped[MAX_JOB_QUEUES] = {};   // per task, parallelFor never makes more than workerCount()
+        parallelFor(mCount / 64 + 1, PROJECTILE_COLLIDE_WORDS_PER_TASK, [&](size_t task, size_t firstWord, size_t lastWord) {
+            for (size_t i = firstWord * 64; i < std::min(mCount, lastWord * 64); ++i) {
+                if (mDeadMask[i / 64] >> (i % 64) & 1) continue;
+                glm::vec3 prev = prevPosition(i), curr = position(i);
+                float obstacleT = 2.0f, targetT = 2.0f;
+                uint32_t obstacle, target;
+                if (obstacles && !obstacles->segmentQuery(prev, curr, obstacleT, obstacle)) obstacleT = 2.0f;
+                if (targets && !targets->segmentQuery(prev, curr, targetT, target)) targetT = 2.0f;
+                if (targetT <= 1.0f && targetT <= obstacleT) {
+                    mHitTarget[i] = target;
+                    mark(i, true, true);
+                } else if (obstacleT <= 1.0f) {
+                    mark(i, false, true);
+                    ++stopped[task];
+                }
+            }
+        });
+        if (targetHits) {
+            for (size_t w = 0; w <= mCount / 64; ++w) {
+                uint64_t hit = mHitMask[w];
+                for (int bit = 0; hit && bit < 64; ++bit)
+                    if (hit >> bit & 1) targetHits->push_back(mHitTarget[w * 64 + bit]);
+            }
         }
-    
-        const glm::vec3& position()     const { return mPosition; }
-        const glm::vec3& prevPosition() const { return mPrevPosition; }
-        const glm::vec3& velocity()     const { return mVelocity; }
-    
-    private:
-        GLuint     mWorldMatrixLocation = 0;
-        glm::vec3  mPosition{0};
-        glm::vec3  mPrevPosition{0};
-        glm::vec3  mVelocity{0};
-    };
-    
+        size_t total = 0;
+        for (size_t count : stopped) total += count;
+        return total;
+    }
+
+    // Projectiles [first, last) one at a time, same math as segmentHitsSphere
+    void stepScalar(const StepParams& p, size_t first, size_t last) {
+        for (size_t i = first; i < last; ++i) {
+            glm::vec3 prev = position(i);
+            glm::vec3 step = velocity(i) * p.dt;
+            glm::vec3 curr = prev + step;
+            mPrevX[i] = prev.x; mPrevY[i] = prev.y; mPrevZ[i] = prev.z;
+            mX[i] = curr.x; mY[i] = curr.y; mZ[i] = curr.z;
+            mAge[i] += p.dt;
+
+            glm::vec3 toTarget = p.target - prev;
+            float t = glm::clamp(glm::dot(toTarget, step) / std::max(glm::dot(step, step), 1e-30f), 0.0f, 1.0f);
+            glm::vec3 d = toTarget - t * step;
+            bool hit = glm::dot(d, d) <= p.radius2;
+            mark(i, hit, hit || glm::dot(curr, curr) > p.maxDistance2);
+        }
+    }
+
+#if defined(__SSE2__) || defined(_M_X64)
+    // Projectiles [first, last), 4 per step, returns where the scalar tail starts
+    size_t stepSSE(const StepParams& p, size_t first, size_t last) {
+        const __m128 dt = _mm_set1_ps(p.dt);
+        const __m128 tx = _mm_set1_ps(p.target.x), ty = _mm_set1_ps(p.target.y), tz = _mm_set1_ps(p.target.z);
+        const __m128 radius2 = _mm_set1_ps(p.radius2), maxDistance2 = _mm_set1_ps(p.maxDistance2);
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), tiny = _mm_set1_ps(1e-30f);
+        size_t i = first;
+        for (; i + 4 <= last; i += 4) {
+            __m128 px = _mm_loadu_ps(&mX[i]), py = _mm_loadu_ps(&mY[i]), pz = _mm_loadu_ps(&mZ[i]);
+            __m128 sx = _mm_mul_ps(_mm_loadu_ps(&mVelX[i]), dt);
+            __m128 sy = _mm_mul_ps(_mm_loadu_ps(&mVelY[i]), dt);
+            __m128 sz = _mm_mul_ps(_mm_loadu_ps(&mVelZ[i]), dt);
+            __m128 cx = _mm_add_ps(px, sx), cy = _mm_add_ps(py, sy), cz = _mm_add_ps(pz, sz);
+            _mm_storeu_ps(&mPrevX[i], px); _mm_storeu_ps(&mPrevY[i], py); _mm_storeu_ps(&mPrevZ[i], pz);
+            _mm_storeu_ps(&mX[i], cx); _mm_storeu_ps(&mY[i], cy); _mm_storeu_ps(&mZ[i], cz);
+            _mm_storeu_ps(&mAge[i], _mm_add_ps(_mm_loadu_ps(&mAge[i]), dt));
+
+            // closest point of the step to the target
+            __m128 ax = _mm_sub_ps(tx, px), ay = _mm_sub_ps(ty, py), az = _mm_sub_ps(tz, pz);
+            __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, sx), _mm_mul_ps(ay, sy)), _mm_mul_ps(az, sz));
+            __m128 length2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, sx), _mm_mul_ps(sy, sy)), _mm_mul_ps(sz, sz));
+            __m128 t = _mm_min_ps(_mm_max_ps(_mm_div_ps(along, _mm_max_ps(length2, tiny)), zero), one);
+            __m128 dx = _mm_sub_ps(ax, _mm_mul_ps(t, sx)), dy = _mm_sub_ps(ay, _mm_mul_ps(t, sy)), dz = _mm_sub_ps(az, _mm_mul_ps(t, sz));
+            __m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            __m128 hit = _mm_cmple_ps(distance2, radius2);
+
+            __m128 range2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)), _mm_mul_ps(cz, cz));
+            __m128 dead = _mm_or_ps(hit, _mm_cmpgt_ps(range2, maxDistance2));
+            mHitMask[i / 64] |= uint64_t(_mm_movemask_ps(hit)) << (i % 64);
+            mDeadMask[i / 64] |= uint64_t(_mm_movemask_ps(dead)) << (i % 64);
+        }
+        return i;
+    }
+#endif
+
+#if defined(__AVX2__)
+    // Projectiles [first, last), 8 per step, returns where the scalar tail starts
+    size_t stepAVX2(const StepParams& p, size_t first, size_t last) {
+        const __m256 dt = _mm256_set1_ps(p.dt);
+        const __m256 tx = _mm256_set1_ps(p.target.x), ty = _mm256_set1_ps(p.target.y), tz = _mm256_set1_ps(p.target.z);
+        const __m256 radius2 = _mm256_set1_ps(p.radius2), maxDistance2 = _mm256_set1_ps(p.maxDistance2);
+        const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f), tiny = _mm256_set1_ps(1e-30f);
+        size_t i = first;
+        for (; i + 8 <= last; i += 8) {
+            __m256 px = _mm256_loadu_ps(&mX[i]), py = _mm256_loadu_ps(&mY[i]), pz = _mm256_loadu_ps(&mZ[i]);
+            __m256 sx = _mm256_mul_ps(_mm256_loadu_ps(&mVelX[i]), dt);
+            __m256 sy = _mm256_mul_ps(_mm256_loadu_ps(&mVelY[i]), dt);
+            __m256 sz = _mm256_mul_ps(_mm256_loadu_ps(&mVelZ[i]), dt);
+            __m256 cx = _mm256_add_ps(px, sx), cy = _mm256_add_ps(py, sy), cz = _mm256_add_ps(pz, sz);
+            _mm256_storeu_ps(&mPrevX[i], px); _mm256_storeu_ps(&mPrevY[i], py); _mm256_storeu_ps(&mPrevZ[i], pz);
+            _mm256_storeu_ps(&mX[i], cx); _mm256_storeu_ps(&mY[i], cy); _mm256_storeu_ps(&mZ[i], cz);
+            _mm256_storeu_ps(&mAge[i], _mm256_add_ps(_mm256_loadu_ps(&mAge[i]), dt));
+
+            __m256 ax = _mm256_sub_ps(tx, px), ay = _mm256_sub_ps(ty, py), az = _mm256_sub_ps(tz, pz);
+            __m256 along = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax, sx), _mm256_mul_ps(ay, sy)), _mm256_mul_ps(az, sz));
+            __m256 length2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(sx, sx), _mm256_mul_ps(sy, sy)), _mm256_mul_ps(sz, sz));
+            __m256 t = _mm256_min_ps(_mm256_max_ps(_mm256_div_ps(along, _mm256_max_ps(length2, tiny)), zero), one);
+            __m256 dx = _mm256_sub_ps(ax, _mm256_mul_ps(t, sx)), dy = _mm256_sub_ps(ay, _mm256_mul_ps(t, sy)), dz = _mm256_sub_ps(az, _mm256_mul_ps(t, sz));
+            __m256 distance2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+            __m256 hit = _mm256_cmp_ps(distance2, radius2, _CMP_LE_OQ);
+
+            __m256 range2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(cx, cx), _mm256_mul_ps(cy, cy)), _mm256_mul_ps(cz, cz));
+            __m256 dead = _mm256_or_ps(hit, _mm256_cmp_ps(range2, maxDistance2, _CMP_GT_OQ));
+            mHitMask[i / 64] |= uint64_t(_mm256_movemask_ps(hit)) << (i % 64);
+            mDeadMask[i / 64] |= uint64_t(_mm256_movemask_ps(dead)) << (i % 64);
+        }
+        return i;
+    }
+#endif
+};
+
+// The projectiles of this frame as instances: position + beam length, unit
+// direction + beam width. Streamed into an orphaned buffer once per frame and
+// drawn with one instanced call per pass, the vertex shaders build the beam's
+// basis (useProjectileInstancing) instead of one world matrix per draw. The
+// shadow casters get their own stream of (projectile, layer) pairs.
+// ---------------------------------------------------------------------------
+class ProjectileInstances {
+public:
+    // maxLayers: shadow layers a caster can be drawn into
+    void create(Geometry& geometry, size_t capacity, size_t maxLayers) {
+        mCapacity = capacity;
+        mCasterCapacity = capacity * maxLayers;
+        mStaging.reserve(2 * mCasterCapacity);
+        glGenBuffers(1, &mInstanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, 2 * capacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glGenBuffers(1, &mCasterVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mCasterVBO);
+        glBufferData(GL_ARRAY_BUFFER, 2 * mCasterCapacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glGenBuffers(1, &mSlotVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, mSlotVBO);
+        glBufferData(GL_ARRAY_BUFFER, mCasterCapacity, NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        mVAO = createInstancedVAO(geometry.createLightCube(), mInstanceVBO);
+        mDepthVAO = createInstancedVAO(geometry.createDepthCube(), mCasterVBO);
+        Geometry::addLayerSlots(mDepthVAO, mSlotVBO);
+    }
+
+    // Gather the moving projectiles (no direction to stretch along otherwise) and
+    // stream them, placed `alpha` of the way between their last two steps
+    void upload(const ProjectilePool& pool, float alpha = 1.0f) {
+        mStaging.clear();
+        for (size_t i = 0; i < pool.size() && mStaging.size() < 2 * mCapacity; ++i) {
+            if (!pool.isMoving(i)) continue;
+            mStaging.push_back(glm::vec4(pool.interpolatedPosition(i, alpha), PROJECTILE_LENGTH));
+            mStaging.push_back(glm::vec4(glm::normalize(pool.velocity(i)), PROJECTILE_WIDTH));
+        }
+        mCount = static_cast<GLsizei>(mStaging.size() / 2);
+        if (mCount == 0) return;
+
+        // Orphan last frame's contents so we don't wait on the draws still reading them
+        glBindBuffer(GL_ARRAY_BUFFER, mInstanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, 2 * mCapacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mStaging.size() * sizeof(glm::vec4), mStaging.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Stream the shadow casters the same way, one (projectile, layer) pair
+    // per bit of layersOf(position, length): the layer slots it reaches
+    template <typename Fn>
+    void uploadCasters(const ProjectilePool& pool, Fn&& layersOf, float alpha = 1.0f) {
+        mStaging.clear();
+        mSlots.clear();
+        for (size_t i = 0; i < pool.size(); ++i) {
+            if (!pool.isMoving(i)) continue;
+            glm::vec3 position = pool.interpolatedPosition(i, alpha);
+            uint32_t layers = layersOf(position, PROJECTILE_LENGTH);
+            for (uint8_t slot = 0; layers && mSlots.size() < mCasterCapacity; ++slot, layers >>= 1) {
+                if (!(layers & 1)) continue;
+                mStaging.push_back(glm::vec4(position, PROJECTILE_LENGTH));
+                mStaging.push_back(glm::vec4(glm::normalize(pool.velocity(i)), PROJECTILE_WIDTH));
+                mSlots.push_back(slot);
+            }
+        }
+        mCasterCount = static_cast<GLsizei>(mSlots.size());
+        if (mCasterCount == 0) return;
+
+        glBindBuffer(GL_ARRAY_BUFFER, mCasterVBO);
+        glBufferData(GL_ARRAY_BUFFER, 2 * mCasterCapacity * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mStaging.size() * sizeof(glm::vec4), mStaging.data());
+        glBindBuffer(GL_ARRAY_BUFFER, mSlotVBO);
+        glBufferData(GL_ARRAY_BUFFER, mCasterCapacity, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, mSlots.size(), mSlots.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // The bound shader must have useProjectileInstancing = true, and
+    // useLayerSlots for the casters
+    void draw() const { draw(mVAO, mCount); }
+    void drawCasters() const { draw(mDepthVAO, mCasterCount); }
+
+    GLsizei size() const { return mCount; }
+
+private:
+    size_t mCapacity = 0;
+    size_t mCasterCapacity = 0;      // pairs
+    GLsizei mCount = 0;
+    GLsizei mCasterCount = 0;
+    GLuint mInstanceVBO = 0;
+    GLuint mCasterVBO = 0;
+    GLuint mSlotVBO = 0;
+    GLuint mVAO = 0;
+    GLuint mDepthVAO = 0;
+    std::vector<glm::vec4> mStaging;
+    std::vector<uint8_t> mSlots;     // layer slot of each caster pair
+
+    void draw(GLuint vao, GLsizei count) const {
+        if (count == 0) return;
+        glBindVertexArray(vao);
+        Renderer::drawArraysInstanced(GL_TRIANGLES, 0, 36, count);
+        glBindVertexArray(0);
+    }
 
+    static GLuint createInstancedVAO(GLuint cubeVAO, GLuint instanceVBO) {
+        glBindVertexArray(cubeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec4), (void*)0);
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, 2 * sizeof(glm::vec4), (void*)sizeof(glm::vec4));
+        glEnableVertexAttribArray(4);
+        glVertexAttribDivisor(4, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindVertexArray(0);
+        return cubeVAO;
+    }
+};
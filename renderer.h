@@ -8,6 +8,9 @@
 
 class Renderer {
 public:
+    // Number of draw calls issued since the last resetDrawCalls()
+    static inline unsigned int drawCalls = 0;
+
     static void setProjectionMatrix(GLuint shaderProgram, const glm::mat4& projectionMatrix) {
         glUseProgram(shaderProgram);
         GLuint loc = glGetUniformLocation(shaderProgram, "projection");
@@ -40,6 +43,37 @@ public:
                 << "\nTextureID: " << textureUnitIndex << std::endl;
         }
     }
+    // Draw wrappers, so every submission is counted in the frame stats
+    // ----------------------------------------------------------------
+    static void drawArrays(GLenum mode, GLint first, GLsizei count) {
+        ++drawCalls;
+        glDrawArrays(mode, first, count);
+    }
+
+    static void drawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount) {
+        ++drawCalls;
+        glDrawArraysInstanced(mode, first, count, instanceCount);
+    }
+
+    static void drawElements(GLenum mode, GLsizei count, GLenum type, const void* offset) {
+        ++drawCalls;
+        glDrawElements(mode, count, type, offset);
+    }
+
+    static void drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* offset, GLsizei instanceCount) {
+        ++drawCalls;
+        glDrawElementsInstanced(mode, count, type, offset, instanceCount);
+    }
+
+    static void multiDrawArraysIndirect(GLenum mode, const void* offset, GLsizei drawCount, GLsizei stride) {
+        ++drawCalls;
+        glMultiDrawArraysIndirect(mode, offset, drawCount, stride);
+    }
+
+    static void resetDrawCalls() {
+        drawCalls = 0;
+    }
+
     // Clear the buffers
     // -----------------
     static void clear() {
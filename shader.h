@@ -16,8 +16,9 @@ public:
     // the program ID
     unsigned int ID;
   
-    // constructor reads and builds the shader
-    Shader(const char* vertexPath, const char* fragmentPath)
+    // constructor reads and builds the shader, defines is a block of #define lines
+    // inserted after the #version line of both stages (compile-time variants)
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string& defines = std::string())
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -40,10 +41,10 @@ public:
             vShaderFile.close();
             fShaderFile.close();
             // convert stream into string
-            vertexCode   = vShaderStream.str();
-            fragmentCode = fShaderStream.str();		
+            vertexCode   = insertDefines(vShaderStream.str(), defines);
+            fragmentCode = insertDefines(fShaderStream.str(), defines);
         }
-        catch(std::ifstream::failure e)
+        catch(const std::ifstream::failure& e)
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ at " << vertexPath << std::endl;
         }
@@ -98,6 +99,154 @@ public:
         std::cout << "SHADER CREATED FROM: " << vertexPath << " and " << fragmentPath << ", ShaderID: " << ID << std::endl;
     }
 
+    // constructor reads and builds a program with a geometry shader between the vertex and fragment stages
+    Shader(const char* vertexPath, const char* geometryPath, const char* fragmentPath)
+    {
+        const char* paths[3] = { vertexPath, geometryPath, fragmentPath };
+        const GLenum types[3] = { GL_VERTEX_SHADER, GL_GEOMETRY_SHADER, GL_FRAGMENT_SHADER };
+        unsigned int stages[3];
+        int success;
+        char infoLog[512];
+
+        ID = glCreateProgram();
+        for (int i = 0; i < 3; ++i)
+        {
+            std::string code;
+            std::ifstream file;
+            file.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+            try
+            {
+                file.open(paths[i]);
+                std::stringstream stream;
+                stream << file.rdbuf();
+                file.close();
+                code = stream.str();
+            }
+            catch(const std::ifstream::failure& e)
+            {
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ at " << paths[i] << std::endl;
+            }
+            const char* shaderCode = code.c_str();
+            stages[i] = glCreateShader(types[i]);
+            glShaderSource(stages[i], 1, &shaderCode, NULL);
+            glCompileShader(stages[i]);
+            glGetShaderiv(stages[i], GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                glGetShaderInfoLog(stages[i], 512, NULL, infoLog);
+                std::cerr << "ERROR::SHADER::COMPILATION_FAILED in " << paths[i] << "\n" << infoLog << std::endl;
+            }
+            glAttachShader(ID, stages[i]);
+        }
+        glLinkProgram(ID);
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if(!success)
+        {
+            glGetProgramInfoLog(ID, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        }
+        for (unsigned int stage : stages) glDeleteShader(stage);
+
+        std::cout << "SHADER CREATED FROM: " << vertexPath << ", " << geometryPath << " and " << fragmentPath << ", ShaderID: " << ID << std::endl;
+    }
+
+    // constructor reads and builds a compute shader program (GL 4.3+)
+    Shader(const char* computePath)
+    {
+        std::string computeCode;
+        std::ifstream cShaderFile;
+        cShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            cShaderFile.open(computePath);
+            std::stringstream cShaderStream;
+            cShaderStream << cShaderFile.rdbuf();
+            cShaderFile.close();
+            computeCode = cShaderStream.str();
+        }
+        catch(const std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ at " << computePath << std::endl;
+        }
+        const char* cShaderCode = computeCode.c_str();
+        int success;
+        char infoLog[512];
+
+        unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(compute, 1, &cShaderCode, NULL);
+        glCompileShader(compute);
+        glGetShaderiv(compute, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(compute, 512, NULL, infoLog);
+            std::cerr << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED in " << computePath << "\n" << infoLog << std::endl;
+        }
+
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if(!success)
+        {
+            glGetProgramInfoLog(ID, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        }
+        glDeleteShader(compute);
+
+        std::cout << "SHADER CREATED FROM: " << computePath << ", ShaderID: " << ID << std::endl;
+    }
+
+    // Recompile a vertex/fragment program with other defines and link it into the
+    // same program object, so everything holding the ID keeps working. The new
+    // program starts with default uniforms, they have to be set again.
+    bool relink(const char* vertexPath, const char* fragmentPath, const std::string& defines)
+    {
+        const char* paths[2] = { vertexPath, fragmentPath };
+        const GLenum types[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+        int success;
+        char infoLog[512];
+
+        GLuint attached[8];
+        GLsizei attachedCount = 0;
+        glGetAttachedShaders(ID, 8, &attachedCount, attached);
+        for (GLsizei i = 0; i < attachedCount; ++i) glDetachShader(ID, attached[i]);
+
+        unsigned int stages[2];
+        for (int i = 0; i < 2; ++i)
+        {
+            std::ifstream file(paths[i]);
+            if (!file)
+                std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ at " << paths[i] << std::endl;
+            std::stringstream stream;
+            stream << file.rdbuf();
+            std::string code = insertDefines(stream.str(), defines);
+            const char* shaderCode = code.c_str();
+            stages[i] = glCreateShader(types[i]);
+            glShaderSource(stages[i], 1, &shaderCode, NULL);
+            glCompileShader(stages[i]);
+            glGetShaderiv(stages[i], GL_COMPILE_STATUS, &success);
+            if (!success)
+            {
+                glGetShaderInfoLog(stages[i], 512, NULL, infoLog);
+                std::cerr << "ERROR::SHADER::COMPILATION_FAILED in " << paths[i] << "\n" << infoLog << std::endl;
+            }
+            glAttachShader(ID, stages[i]);
+        }
+        glLinkProgram(ID);
+        glGetProgramiv(ID, GL_LINK_STATUS, &success);
+        if(!success)
+        {
+            glGetProgramInfoLog(ID, 512, NULL, infoLog);
+            std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+        }
+        for (unsigned int stage : stages)
+        {
+            glDetachShader(ID, stage);
+            glDeleteShader(stage);
+        }
+        return success != 0;
+    }
+
     // Activate/Use Program
     void use() 
     { 
@@ -122,5 +271,16 @@ public:
     {
         glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
     }
+
+private:
+    // #defines have to come after the #version line
+    static std::string insertDefines(const std::string& code, const std::string& defines)
+    {
+        if (defines.empty()) return code;
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if (lineEnd == std::string::npos) return defines + code;
+        return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
+    }
 };
 #endif
\ No newline at end of file
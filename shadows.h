@@ -0,0 +1,356 @@
+#pragma once
+
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+#include "frustum.h"
+#include "shader.h"
+
+constexpr int MAX_CASCADES = 4;
+constexpr int MAX_SHADOW_LIGHTS = 2;
+constexpr int MAX_SHADOW_LAYERS = MAX_CASCADES * MAX_SHADOW_LIGHTS;
+
+// Shadow filtering kernels, compiled into the lighting shaders as SHADOW_KERNEL.
+// The depth array is sampled through a comparison sampler so every tap is
+// already a hardware filtered 2x2 PCF.
+// ---------------------------------------------------------------------------
+enum class ShadowKernel {
+    Off = 0,      // no shadow lookups, baseline for the kernel benchmark
+    Bilinear,     // 1 tap
+    Box4,         // 4 taps half a texel apart, 3x3 texels tent filtered
+    Poisson,      // 8 tap Poisson disk rotated per pixel
+    Count
+};
+
+inline const char* shadowKernelName(ShadowKernel kernel) {
+    switch (kernel) {
+        case ShadowKernel::Off: return "off";
+        case ShadowKernel::Bilinear: return "1-tap bilinear";
+        case ShadowKernel::Box4: return "4-tap";
+        case ShadowKernel::Poisson: return "rotated Poisson";
+        default: return "unknown";
+    }
+}
+
+inline std::string shadowKernelDefines(ShadowKernel kernel) {
+    return "#define SHADOW_KERNEL " + std::to_string(static_cast<int>(kernel)) + "\n";
+}
+
+// Cascaded shadow maps: the camera frustum (up to maxShadowDistance) is split
+// into slices, each slice gets an ortho light matrix fitted to its bounding
+// sphere and snapped to whole texels so the shadows don't shimmer when the
+// camera moves. Every light gets its own set of cascades, they all live in
+// one depth texture array, layer = light * cascadeCount + cascade, and are
+// drawn in a single layered pass (each caster is instanced once per layer).
+//
+// With the static cache on, the towers are rendered into a second array that
+// is only redrawn when a cascade has to move: the light direction is quantized
+// into lightAngleSteps steps, and each cascade is placed with some slack so the
+// camera can move a bit before the slice leaves it. Every frame the cached
+// layers are copied into the live array and only the dynamic casters are drawn.
+// -----------------------------------------------------------------------------
+class CascadedShadowMap {
+public:
+    int cascadeCount = MAX_CASCADES;
+    int lightCount = MAX_SHADOW_LIGHTS;
+    int resolution = 1024;
+    float maxShadowDistance = 150.0f;  // no shadows further than this from the camera
+    float splitLambda = 0.8f;          // 0 = uniform splits, 1 = logarithmic splits
+    float casterPadding = 100.0f;      // extends the light volume toward the light for tall casters
+    float maxShadowLength = 100.0f;    // how far a caster is extruded along the light when culling casters
+    bool staticCache = true;           // toggled with B
+    int lightAngleSteps = 32;          // light directions per orbit when caching (--shadow-steps)
+    float cacheSlack = 0.25f;          // extra cascade size when caching, as a fraction of its radius
+
+    GLuint depthTexture = 0;           // live depth, sampled by the lighting pass
+    GLuint staticTexture = 0;          // cached static casters
+    GLuint FBO = 0;
+    GLuint staticFBO = 0;
+
+    void create() {
+        depthTexture = createDepthArray();
+        staticTexture = createDepthArray();
+        FBO = createFramebuffer(depthTexture);
+        staticFBO = createFramebuffer(staticTexture);
+        copyImage = GLEW_VERSION_4_3 || GLEW_ARB_copy_image;
+    }
+
+    // Light step of an angle along the orbit (radians)
+    int quantizeLightAngle(float angle) const {
+        float step = 6.2831853f / lightAngleSteps;
+        int index = static_cast<int>(std::floor(angle / step)) % lightAngleSteps;
+        return index < 0 ? index + lightAngleSteps : index;
+    }
+    float lightStepAngle(int lightStep) const { return lightStep * 6.2831853f / lightAngleSteps; }
+
+    int layerCount() const { return lightCount * cascadeCount; }
+    int layer(int light, int cascade) const { return light * cascadeCount + cascade; }
+
+    // Fit the cascades of every light to the camera, lightDirs point from the lights
+    // toward the scene. lightSteps identify the directions when caching, a layer
+    // placed for another step is refreshed at most one per frame.
+    void update(const glm::mat4& cameraView, float fovY, float aspect, float nearPlane, float farPlane,
+                const glm::vec3* lightDirs, const int* lightSteps) {
+        float shadowFar = std::min(farPlane, maxShadowDistance);
+        for (int light = 0; light < lightCount; ++light) directions[light] = lightDirs[light];
+        bool refreshed = false;
+        rebuilt = 0;
+
+        // Practical split scheme, blend of logarithmic and uniform splits
+        for (int i = 0; i < cascadeCount; ++i) {
+            float p = (i + 1) / static_cast<float>(cascadeCount);
+            float logSplit = nearPlane * std::pow(shadowFar / nearPlane, p);
+            float uniformSplit = nearPlane + (shadowFar - nearPlane) * p;
+            splits[i] = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+        }
+
+        // Bounding spheres and frustums of the camera slices, shared by every light
+        glm::vec3 centers[MAX_CASCADES];
+        float radii[MAX_CASCADES];
+        for (int i = 0; i < cascadeCount; ++i) {
+            float sliceNear = i == 0 ? nearPlane : splits[i - 1];
+            sliceSphere(cameraView, fovY, aspect, sliceNear, splits[i], centers[i], radii[i]);
+            slices[i] = Frustum::fromMatrix(glm::perspective(fovY, aspect, sliceNear, splits[i]) * cameraView);
+        }
+
+        // Rotate the starting layer so stale ones get refreshed in turn
+        int first = nextRefresh;
+        for (int n = 0; n < layerCount(); ++n) {
+            int i = (n + first) % layerCount();
+            int light = i / cascadeCount, cascade = i % cascadeCount;
+            const glm::vec3& center = centers[cascade];
+            float radius = radii[cascade];
+
+            Placement& placement = placements[i];
+            placement.dirty = true;
+            if (!staticCache) {
+                place(placement, center, radius, lightDirs[light], lightSteps[light], false);
+            }
+            else if (!placement.valid || !placement.cached || !covers(placement, center, radius)) {
+                place(placement, center, radius, lightDirs[light], lightSteps[light], true);
+            }
+            else if (placement.lightStep != lightSteps[light] && !refreshed) {
+                place(placement, center, radius, lightDirs[light], lightSteps[light], true);
+                refreshed = true;
+                nextRefresh = (i + 1) % layerCount();
+            }
+            else {
+                placement.dirty = false;
+            }
+            if (placement.dirty) ++rebuilt;
+
+            matrices[i] = placement.matrix;
+            frustums[i] = Frustum::fromMatrix(matrices[i]);
+            // A cached layer is reused while the slice moves around inside it,
+            // so its static casters have to cover every receiver in the cascade box
+            receivers[i] = placement.cached ? Frustum::fromMatrix(placement.receiverMatrix) : slices[cascade];
+        }
+    }
+
+    const glm::mat4& matrix(int layer) const { return matrices[layer]; }
+    const Frustum& frustum(int layer) const { return frustums[layer]; }
+    // Slice of the camera frustum shaded by a cascade, casters must shadow something in it
+    const Frustum& sliceFrustum(int cascade) const { return slices[cascade]; }
+    // Receivers the static casters of a layer are culled against (the slice, or the whole box when cached)
+    const Frustum& receiverFrustum(int layer) const { return receivers[layer]; }
+    const glm::vec3& lightDirection(int light) const { return directions[light]; }
+    // True when the static casters of a layer have to be drawn this frame
+    bool needsStaticPass(int layer) const { return placements[layer].dirty; }
+    int rebuiltLayers() const { return rebuilt; }
+
+    // Layered render target for every layer, clears them all (everything drawn every frame)
+    void beginLayered() {
+        bindLayered(FBO, depthTexture);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+
+    // Layered render target for the cached static casters, only the listed layers are cleared
+    void beginStatic(const int* layers, int count) {
+        for (int i = 0; i < count; ++i) {
+            glBindFramebuffer(GL_FRAMEBUFFER, staticFBO);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticTexture, 0, layers[i]);
+            glClear(GL_DEPTH_BUFFER_BIT);
+        }
+        bindLayered(staticFBO, staticTexture);
+    }
+
+    // Copy the cached static depth into the live array and keep it bound for the dynamic casters
+    void beginDynamic() {
+        if (copyImage) {
+            glCopyImageSubData(staticTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0,
+                               depthTexture, GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, resolution, resolution, layerCount());
+        }
+        else {
+            // Blits only see one layer of each attachment
+            for (int i = 0; i < layerCount(); ++i) {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, staticFBO);
+                glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, staticTexture, 0, i);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+                glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthTexture, 0, i);
+                glBlitFramebuffer(0, 0, resolution, resolution, 0, 0, resolution, resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+            }
+        }
+        bindLayered(FBO, depthTexture);
+    }
+
+    // Layers the next layered draws go to, their slots are the positions in
+    // `layers`. Pair streams give the slot of every instance, repeated draws
+    // go to every slot unless setDrawSlots() picks some of them.
+    void setLayers(Shader& shader, const int* layers, int count) const {
+        shader.use();
+        for (int i = 0; i < count; ++i) {
+            std::string index = "[" + std::to_string(i) + "]";
+            shader.setMat4("layerMatrices" + index, matrices[layers[i]]);
+            shader.setInt("layerIndex" + index, layers[i]);
+        }
+        setDrawSlots(shader, (1u << count) - 1u);
+    }
+
+    // Make the next repeated draws go to the slots set in slotMask (bit i =
+    // slot i of setLayers), returns the instances each caster must be drawn
+    static int setDrawSlots(Shader& shader, uint32_t slotMask) {
+        GLint slots[MAX_SHADOW_LAYERS];
+        int count = 0;
+        for (int i = 0; i < MAX_SHADOW_LAYERS; ++i)
+            if (slotMask & (1u << i)) slots[count++] = i;
+        if (count > 0) glUniform1iv(glGetUniformLocation(shader.ID, "drawSlots"), count, slots);
+        shader.setInt("layerCount", std::max(count, 1));
+        return count;
+    }
+
+    // Bind the array to a texture unit and set the cascade uniforms of a lighting shader
+    void bind(Shader& shader, int textureUnit) const {
+        shader.use();
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, depthTexture);
+        shader.setInt("shadowMap", textureUnit);
+        shader.setInt("cascadeCount", cascadeCount);
+        for (int i = 0; i < cascadeCount; ++i) {
+            std::string index = "[" + std::to_string(i) + "]";
+            glUniform1f(glGetUniformLocation(shader.ID, ("cascadeSplits" + index).c_str()), splits[i]);
+        }
+        for (int i = 0; i < layerCount(); ++i)
+            shader.setMat4("lightSpaceMatrices[" + std::to_string(i) + "]", matrices[i]);
+    }
+
+private:
+    // Where a cascade sits in light space, kept between frames for the static cache
+    struct Placement {
+        glm::mat4 lightView = glm::mat4(1.0f);
+        glm::mat4 matrix = glm::mat4(1.0f);
+        glm::mat4 receiverMatrix = glm::mat4(1.0f);  // same box without the caster padding
+        glm::vec3 center = glm::vec3(0.0f);  // light space
+        float halfSize = 0.0f;
+        int lightStep = -1;
+        bool cached = false;  // placed with the cache slack
+        bool valid = false;
+        bool dirty = true;
+    };
+
+    float splits[MAX_CASCADES] = {};
+    glm::mat4 matrices[MAX_SHADOW_LAYERS];
+    Frustum frustums[MAX_SHADOW_LAYERS];
+    Frustum slices[MAX_CASCADES];
+    Frustum receivers[MAX_SHADOW_LAYERS];
+    Placement placements[MAX_SHADOW_LAYERS];
+    glm::vec3 directions[MAX_SHADOW_LIGHTS];
+    int nextRefresh = 0;
+    int rebuilt = 0;
+    bool copyImage = false;
+
+    GLuint createDepthArray() const {
+        GLuint texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT32F, resolution, resolution, layerCount(), 0,
+                     GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        // compared against the reference depth on lookup, linear gives 2x2 PCF per tap
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        float borderColor[] = { 1.0, 1.0, 1.0, 1.0 };
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+        return texture;
+    }
+
+    GLuint createFramebuffer(GLuint texture) const {
+        GLuint framebuffer;
+        glGenFramebuffers(1, &framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cerr << "SHADOW LOG: cascade framebuffer is not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return framebuffer;
+    }
+
+    // Attach the whole array, gl_Layer picks the layer of each primitive
+    void bindLayered(GLuint framebuffer, GLuint texture) const {
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0);
+        glViewport(0, 0, resolution, resolution);
+    }
+
+    // Bounding sphere of a slice of the camera frustum, its size doesn't change when the camera rotates
+    static void sliceSphere(const glm::mat4& cameraView, float fovY, float aspect, float sliceNear, float sliceFar,
+                            glm::vec3& center, float& radius) {
+        glm::mat4 inverseSlice = glm::inverse(glm::perspective(fovY, aspect, sliceNear, sliceFar) * cameraView);
+        glm::vec3 corners[8];
+        center = glm::vec3(0.0f);
+        for (int i = 0; i < 8; ++i) {
+            glm::vec4 p = inverseSlice * glm::vec4((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 4) ? 1.0f : -1.0f, 1.0f);
+            corners[i] = glm::vec3(p) / p.w;
+            center += corners[i] / 8.0f;
+        }
+        radius = 0.0f;
+        for (const auto& corner : corners) radius = std::max(radius, glm::length(corner - center));
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+    }
+
+    // The cached placement still holds the whole sphere
+    bool covers(const Placement& placement, const glm::vec3& center, float radius) const {
+        glm::vec3 c = glm::vec3(placement.lightView * glm::vec4(center, 1.0f));
+        float room = placement.halfSize - radius;
+        return std::abs(c.x - placement.center.x) <= room && std::abs(c.y - placement.center.y) <= room &&
+               std::abs(c.z - placement.center.z) <= room;
+    }
+
+    // Light view with a fixed origin, the sphere center snapped to whole texels.
+    // When caching, the cascade gets cacheSlack extra room and is snapped to a
+    // coarser grid (still a whole number of texels) so it moves less often.
+    void place(Placement& placement, const glm::vec3& center, float radius, const glm::vec3& lightDir, int lightStep, bool cached) const {
+        glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        placement.lightView = glm::lookAt(glm::vec3(0.0f), lightDir, up);
+        placement.halfSize = cached ? radius * (1.0f + cacheSlack) : radius;
+
+        float texel = 2.0f * placement.halfSize / resolution;
+        float grid = cached ? std::max(texel, std::floor(radius * cacheSlack / texel) * texel) : texel;
+        glm::vec3 c = glm::vec3(placement.lightView * glm::vec4(center, 1.0f));
+        if (cached) c = glm::round(c / grid) * grid;
+        else c = glm::vec3(std::floor(c.x / grid) * grid, std::floor(c.y / grid) * grid, c.z);
+
+        // The view looks down -Z, so depth along the light is -c.z
+        float h = placement.halfSize;
+        glm::mat4 lightProjection = glm::ortho(c.x - h, c.x + h, c.y - h, c.y + h, -c.z - h - casterPadding, -c.z + h);
+        placement.center = c;
+        placement.matrix = lightProjection * placement.lightView;
+        placement.receiverMatrix = glm::ortho(c.x - h, c.x + h, c.y - h, c.y + h, -c.z - h, -c.z + h) * placement.lightView;
+        placement.lightStep = lightStep;
+        placement.cached = cached;
+        placement.valid = true;
+        placement.dirty = true;
+    }
+};
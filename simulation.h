@@ -0,0 +1,232 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "fixedstep.h"
+#include "flowfield.h"
+#include "monsters.h"
+#include "projectile.h"
+#include "spatialgrid.h"
+#include "triplebuffer.h"
+
+constexpr float TURRET_BARREL_SPEED = 180.0f;   // deg/sec while Q / E is held
+constexpr float TURRET_BARREL_LIMIT = 75.0f;    // the barrel stays in [-75, +75]
+constexpr float SPINNING_CUBE_SPEED = 180.0f;   // deg/sec
+constexpr uint32_t SHOT_RING_SIZE = 256;        // shots the main thread can queue between two steps
+
+// Seconds on a steady clock, shared by the simulation and the render side
+inline double simulationNow() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// What the main thread read from the keyboard and mouse, for the simulation
+// (GLFW input can only be read on the main thread)
+// ---------------------------------------------------------------------------
+struct SimulationInput {
+    bool active = true;          // false while a GPU benchmark holds everything still
+    bool forward = false, back = false, left = false, right = false, fast = false;
+    bool barrelUp = false, barrelDown = false;
+    glm::vec3 lookAt{ 0.0f, 0.0f, -1.0f };
+    glm::vec3 sideVector{ 1.0f, 0.0f, 0.0f };
+    float walkSpeed = 1.0f, fastSpeed = 2.0f;
+    uint32_t shots = 0;          // turret shots so far, the simulation fires the ones it has not seen
+    struct Shot { glm::vec3 position{ 0.0f }, velocity{ 0.0f }; };
+    Shot shotRing[SHOT_RING_SIZE];  // shot n is at shotRing[n % SHOT_RING_SIZE]
+
+    void fire(const glm::vec3& position, const glm::vec3& velocity) {
+        shotRing[shots % SHOT_RING_SIZE] = { position, velocity };
+        ++shots;
+    }
+};
+
+// Everything the render side reads from the simulation: the state after the
+// last step and after the one before it, to draw in between
+// ---------------------------------------------------------------------------
+struct WorldSnapshot {
+    double time = 0.0;           // simulationNow() at which the last step's state is current
+    glm::vec3 cameraPosition{ 0.0f }, previousCameraPosition{ 0.0f };
+    float turretBarrelZDeg = 0.0f, previousTurretBarrelZDeg = 0.0f;
+    float spinningCubeAngle = 0.0f, previousSpinningCubeAngle = 0.0f;
+    ProjectilePool projectiles{ MAX_PROJECTILES };
+    MonsterPool monsters{ MAX_MONSTERS };
+
+    // Running totals, the render side reports what changed since its last frame
+    uint64_t steps = 0;
+    double simSeconds = 0.0;
+    uint64_t monsterHits = 0;
+    uint64_t towerHits = 0;
+    uint64_t flowUpdates = 0;
+
+    // Where `now` falls between the previous step (0) and the last one (1)
+    float alpha(double now) const {
+        return static_cast<float>(std::clamp((now - time) / SIMULATION_STEP, 0.0, 1.0));
+    }
+};
+
+// The game simulation (camera movement, turret, projectiles, monsters) in
+// fixed steps, GL free. It either runs on its own thread, reading the newest
+// input and publishing a snapshot after its steps through triple buffers, or
+// is updated by the main thread once per frame on machines with one core
+// (and with --no-sim-thread, for comparison). The render side only ever
+// reads the published snapshots.
+// ---------------------------------------------------------------------------
+class GameSimulation {
+public:
+    // Where a monster goes when it is hit, given the camera position (main sets it)
+    std::function<glm::vec3(const glm::vec3&)> spawnPoint = [](const glm::vec3& camera) { return camera + glm::vec3(10.0f, 0.0f, 0.0f); };
+    // How far from the camera the monsters' flow field reaches (meters, 0 = the whole city)
+    float flowRadius = 0.0f;
+
+    GameSimulation() : mProjectiles(MAX_PROJECTILES), mMonsters(MAX_MONSTERS) {}
+    ~GameSimulation() { stop(); }
+
+    // Starting state, published as the first snapshot. The monsters walk
+    // along monsterPaths (its occupancy already built) toward the camera,
+    // from then on only the simulation touches it.
+    void reset(const SpatialGrid* towers, FlowField* monsterPaths, const glm::vec3& cameraPosition, float turretBarrelZDeg,
+               int monsterCount, TripleBuffer<WorldSnapshot>& snapshots) {
+        mTowers = towers;
+        mMonsterPaths = monsterPaths;
+        mCameraPosition = mPreviousCameraPosition = cameraPosition;
+        mTurretBarrelZDeg = mPreviousTurretBarrelZDeg = turretBarrelZDeg;
+        for (int i = 0; i < monsterCount && mMonsters.spawn(glm::vec3(0.0f)); ++i)
+            mMonsters.setPosition(i, spawnPoint(mCameraPosition));
+        mClock = FixedTimestep();
+        mLastUpdate = simulationNow();
+        writeSnapshot(snapshots.writeBuffer(), mLastUpdate);
+        snapshots.publish();
+    }
+
+    size_t monsterCount() const { return mMonsters.size(); }
+
+    // Run the steps the time since the last update pays for, then publish the
+    // new state. Returns the steps run.
+    int update(const SimulationInput& input, TripleBuffer<WorldSnapshot>& snapshots) {
+        double now = simulationNow();
+        int steps = mClock.advance(now - mLastUpdate);
+        mLastUpdate = now;
+        if (steps == 0) return 0;
+        double start = simulationNow();
+        for (int s = 0; s < steps; ++s) step(input, static_cast<float>(mClock.step()));
+        mSimSeconds += simulationNow() - start;
+        writeSnapshot(snapshots.writeBuffer(), now - mClock.alpha() * mClock.step());
+        snapshots.publish();
+        return steps;
+    }
+
+    // Simulation thread: update whenever a step is due, sleep in between
+    void start(TripleBuffer<SimulationInput>& inputs, TripleBuffer<WorldSnapshot>& snapshots) {
+        mRunning.store(true, std::memory_order_release);
+        mThread = std::thread([this, &inputs, &snapshots] {
+            mLastUpdate = simulationNow();
+            while (mRunning.load(std::memory_order_acquire)) {
+                inputs.acquire();
+                update(inputs.readBuffer(), snapshots);
+                std::this_thread::sleep_for(std::chrono::duration<double>((1.0 - mClock.alpha()) * mClock.step()));
+            }
+        });
+    }
+    void stop() {
+        if (!mThread.joinable()) return;
+        mRunning.store(false, std::memory_order_release);
+        mThread.join();
+    }
+    bool threaded() const { return mThread.joinable(); }
+
+private:
+    const SpatialGrid* mTowers = nullptr;
+    FlowField* mMonsterPaths = nullptr;
+    FixedTimestep mClock;
+    double mLastUpdate = 0.0;
+    std::thread mThread;
+    std::atomic<bool> mRunning{ false };
+
+    glm::vec3 mCameraPosition{ 0.0f }, mPreviousCameraPosition{ 0.0f };
+    float mTurretBarrelZDeg = 0.0f, mPreviousTurretBarrelZDeg = 0.0f;
+    float mSpinningCubeAngle = 0.0f, mPreviousSpinningCubeAngle = 0.0f;
+    ProjectilePool mProjectiles;
+    MonsterPool mMonsters;
+    SphereGrid mMonsterGrid;
+    std::vector<uint32_t> mMonsterHits;
+    uint32_t mShotsFired = 0;
+
+    uint64_t mSteps = 0;
+    double mSimSeconds = 0.0;
+    uint64_t mMonsterHitTotal = 0;
+    uint64_t mTowerHitTotal = 0;
+    uint64_t mFlowUpdates = 0;
+
+    // One fixed step: keep the previous state for interpolation, move the
+    // camera and turret, fire the new shots, walk the monsters toward the
+    // camera (the flow field follows it from cell to cell), then the
+    // projectiles: pair their segments with the monsters near them
+    // (broadphase grid rebuilt every step), stop them at the towers (grid
+    // walk) + lifetime cull. Every monster hit respawns somewhere else.
+    void step(const SimulationInput& input, float dt) {
+        mPreviousCameraPosition = mCameraPosition;
+        mPreviousTurretBarrelZDeg = mTurretBarrelZDeg;
+        mPreviousSpinningCubeAngle = mSpinningCubeAngle;
+        if (input.active) {
+            float speed = input.fast ? input.fastSpeed : input.walkSpeed;
+            if (input.forward) mCameraPosition += input.lookAt * dt * speed;
+            if (input.back) mCameraPosition -= input.lookAt * dt * speed;
+            if (input.right) mCameraPosition += input.sideVector * dt * speed;
+            if (input.left) mCameraPosition -= input.sideVector * dt * speed;
+            if (input.barrelUp) mTurretBarrelZDeg += TURRET_BARREL_SPEED * dt;
+            if (input.barrelDown) mTurretBarrelZDeg -= TURRET_BARREL_SPEED * dt;
+            mTurretBarrelZDeg = glm::clamp(mTurretBarrelZDeg, -TURRET_BARREL_LIMIT, TURRET_BARREL_LIMIT);
+        }
+        mSpinningCubeAngle += SPINNING_CUBE_SPEED * dt;
+
+        // Older shots than the ring holds were overwritten before this step saw them
+        if (input.shots - mShotsFired > SHOT_RING_SIZE) {
+            std::cout << "PROJECTILE LOG: " << input.shots - mShotsFired - SHOT_RING_SIZE << " shots queued past the ring, dropped" << std::endl;
+            mShotsFired = input.shots - SHOT_RING_SIZE;
+        }
+        for (; mShotsFired != input.shots; ++mShotsFired)
+            if (!mProjectiles.spawn(input.shotRing[mShotsFired % SHOT_RING_SIZE].position,
+                                    input.shotRing[mShotsFired % SHOT_RING_SIZE].velocity))
+                std::cout << "PROJECTILE LOG: " << mProjectiles.capacity() << " projectiles in flight, shot dropped" << std::endl;
+
+        if (mMonsterPaths) {
+            if (mMonsterPaths->update(mCameraPosition, flowRadius)) ++mFlowUpdates;
+            mMonsters.walk(*mMonsterPaths, mCameraPosition, dt);
+        }
+
+        mMonsters.buildGrid(mMonsterGrid);
+        mMonsterHits.clear();
+        mProjectiles.simulate(dt, mMonsterGrid, mMonsterHits, mTowers);
+        std::sort(mMonsterHits.begin(), mMonsterHits.end());
+        mMonsterHits.erase(std::unique(mMonsterHits.begin(), mMonsterHits.end()), mMonsterHits.end());
+        for (uint32_t monster : mMonsterHits) mMonsters.setPosition(monster, spawnPoint(mCameraPosition));
+
+        ++mSteps;
+        mMonsterHitTotal += mMonsterHits.size();
+        mTowerHitTotal += mProjectiles.obstacleHits();
+    }
+
+    void writeSnapshot(WorldSnapshot& snapshot, double time) const {
+        snapshot.time = time;
+        snapshot.cameraPosition = mCameraPosition;
+        snapshot.previousCameraPosition = mPreviousCameraPosition;
+        snapshot.turretBarrelZDeg = mTurretBarrelZDeg;
+        snapshot.previousTurretBarrelZDeg = mPreviousTurretBarrelZDeg;
+        snapshot.spinningCubeAngle = mSpinningCubeAngle;
+        snapshot.previousSpinningCubeAngle = mPreviousSpinningCubeAngle;
+        snapshot.projectiles = mProjectiles;
+        snapshot.monsters = mMonsters;
+        snapshot.steps = mSteps;
+        snapshot.simSeconds = mSimSeconds;
+        snapshot.monsterHits = mMonsterHitTotal;
+        snapshot.towerHits = mTowerHitTotal;
+        snapshot.flowUpdates = mFlowUpdates;
+    }
+};
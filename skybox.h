@@ -0,0 +1,64 @@
+#pragma once
+
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <iostream>
+
+#include "geometry.h"
+#include "renderer.h"
+#include "shader.h"
+#include "texture.h"
+
+// Cubemap sky around the camera. It is drawn after the opaque geometry: the
+// vertex shader puts it on the far plane (depth = 1.0) and the depth test is
+// GL_LEQUAL with writes off, so early depth rejection skips every pixel that
+// something else already covers. drawFirst puts it back in front of the scene
+// (no depth test) to measure the difference.
+// ---------------------------------------------------------------------------
+class Skybox {
+public:
+    bool drawFirst = false;   // toggled with Y
+
+    void create(Geometry& geometry) {
+        const char* faces[6] = {
+            "Textures/Skybox/right.jpg", "Textures/Skybox/left.jpg",
+            "Textures/Skybox/top.jpg", "Textures/Skybox/bottom.jpg",
+            "Textures/Skybox/front.jpg", "Textures/Skybox/back.jpg"
+        };
+        cubemap = Texture::loadCubemap(faces);
+        vao = geometry.createSkybox();
+        shader = new Shader("Shaders/Skybox.vert", "Shaders/Skybox.frag");
+    }
+
+    // Draw the sky, call before the scene when drawFirst, after it otherwise
+    void draw(const glm::mat4& view, const glm::mat4& projection, int textureUnit) {
+        shader->use();
+        // rotation only, the sky stays around the camera
+        shader->setMat4("view", glm::mat4(glm::mat3(view)));
+        shader->setMat4("projection", projection);
+        glActiveTexture(GL_TEXTURE0 + textureUnit);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+        shader->setInt("skybox", textureUnit);
+
+        GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+        glDisable(GL_CULL_FACE);
+        glDepthMask(GL_FALSE);
+        if (drawFirst) glDisable(GL_DEPTH_TEST);
+        else glDepthFunc(GL_LEQUAL);
+
+        glBindVertexArray(vao);
+        Renderer::drawArrays(GL_TRIANGLES, 0, 36);
+        glBindVertexArray(0);
+
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+        if (cullFace) glEnable(GL_CULL_FACE);
+    }
+
+private:
+    GLuint cubemap = 0;
+    GLuint vao = 0;
+    Shader* shader = nullptr;
+};
@@ -0,0 +1,354 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "frustum.h"   // AABBList
+
+constexpr float SPATIAL_GRID_CELL_SIZE = 8.0f;   // about one tower per cell at the city's density
+
+// Segment vs box (slab test), tHit = first contact in [0, 1] along a -> b
+// -----------------------------------------------------------------------
+inline bool segmentHitsAABB(const glm::vec3& a, const glm::vec3& b,
+                            const glm::vec3& boxMin, const glm::vec3& boxMax, float& tHit) {
+    float tMin = 0.0f, tMax = 1.0f;
+    glm::vec3 d = b - a;
+    for (int axis = 0; axis < 3; ++axis) {
+        if (std::abs(d[axis]) < 1e-12f) {
+            if (a[axis] < boxMin[axis] || a[axis] > boxMax[axis]) return false;
+            continue;
+        }
+        float inv = 1.0f / d[axis];
+        float t0 = (boxMin[axis] - a[axis]) * inv;
+        float t1 = (boxMax[axis] - a[axis]) * inv;
+        if (t0 > t1) std::swap(t0, t1);
+        tMin = std::max(tMin, t0);
+        tMax = std::min(tMax, t1);
+        if (tMin > tMax) return false;
+    }
+    tHit = tMin;
+    return true;
+}
+
+// Segment vs sphere, tHit = first contact in [0, 1] along a -> b (0 if a is inside)
+// ---------------------------------------------------------------------------------
+inline bool segmentEntersSphere(const glm::vec3& a, const glm::vec3& b,
+                                const glm::vec3& center, float radius, float& tHit) {
+    glm::vec3 d = b - a, m = a - center;
+    float c = glm::dot(m, m) - radius * radius;
+    if (c <= 0.0f) { tHit = 0.0f; return true; }
+    float dd = glm::dot(d, d);
+    float half = glm::dot(m, d);
+    if (half >= 0.0f || dd == 0.0f) return false;   // moving away
+    float discriminant = half * half - dd * c;
+    if (discriminant < 0.0f) return false;
+    tHit = (-half - std::sqrt(discriminant)) / dd;
+    return tHit <= 1.0f;
+}
+
+// Static uniform grid over the XZ plane, built once from a list of boxes (the
+// towers). Every box is listed in each cell its footprint overlaps, in CSR
+// form: the entries of cell c are entries[cellStart[c], cellStart[c + 1]) and
+// carry a copy of their box, so a query reads one contiguous run per cell
+// and never touches the box list. Queries that can see a box from several
+// cells report it only from the cell holding the min corner of the overlap.
+// ---------------------------------------------------------------------------
+class SpatialGrid {
+public:
+    struct Entry {
+        glm::vec3 min;
+        uint32_t item;     // index in the box list the grid was built from
+        glm::vec3 max;
+        float pad;
+    };
+
+    void build(const AABBList& boxes, float cellSize = SPATIAL_GRID_CELL_SIZE) {
+        glm::vec2 lo(1e30f), hi(-1e30f);
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            lo = glm::min(lo, glm::vec2(boxes.centerX[i] - boxes.extentX[i], boxes.centerZ[i] - boxes.extentZ[i]));
+            hi = glm::max(hi, glm::vec2(boxes.centerX[i] + boxes.extentX[i], boxes.centerZ[i] + boxes.extentZ[i]));
+        }
+        if (boxes.size() == 0) lo = hi = glm::vec2(0.0f);
+        mOriginX = lo.x;
+        mOriginZ = lo.y;
+        mCellSize = cellSize;
+        mInvCellSize = 1.0f / cellSize;
+        mCellsX = std::max(1, static_cast<int>(std::ceil((hi.x - lo.x) * mInvCellSize)));
+        mCellsZ = std::max(1, static_cast<int>(std::ceil((hi.y - lo.y) * mInvCellSize)));
+
+        // Counting sort of the (cell, box) pairs into the CSR arrays
+        mCellStart.assign(static_cast<size_t>(mCellsX) * mCellsZ + 1, 0);
+        auto forEachCell = [&](size_t i, auto&& fn) {
+            int x0 = cellX(boxes.centerX[i] - boxes.extentX[i]), x1 = cellX(boxes.centerX[i] + boxes.extentX[i]);
+            int z0 = cellZ(boxes.centerZ[i] - boxes.extentZ[i]), z1 = cellZ(boxes.centerZ[i] + boxes.extentZ[i]);
+            for (int z = z0; z <= z1; ++z)
+                for (int x = x0; x <= x1; ++x) fn(cellIndex(x, z));
+        };
+        for (size_t i = 0; i < boxes.size(); ++i)
+            forEachCell(i, [&](size_t cell) { ++mCellStart[cell + 1]; });
+        for (size_t c = 1; c < mCellStart.size(); ++c) mCellStart[c] += mCellStart[c - 1];
+        mEntries.resize(mCellStart.back());
+        std::vector<uint32_t> cursor(mCellStart.begin(), mCellStart.end() - 1);
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            glm::vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+            glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+            Entry entry{ center - extent, static_cast<uint32_t>(i), center + extent, 0.0f };
+            forEachCell(i, [&](size_t cell) { mEntries[cursor[cell]++] = entry; });
+        }
+    }
+
+    size_t cellCount() const { return mCellStart.empty() ? 0 : mCellStart.size() - 1; }
+    size_t entryCount() const { return mEntries.size(); }
+
+    // Boxes whose XZ footprint contains the point
+    void queryPoint(float x, float z, std::vector<uint32_t>& out) const {
+        out.clear();
+        if (!insideGrid(x, z)) return;
+        size_t cell = cellIndex(cellX(x), cellZ(z));
+        for (uint32_t e = mCellStart[cell]; e < mCellStart[cell + 1]; ++e) {
+            const Entry& entry = mEntries[e];
+            if (x >= entry.min.x && x <= entry.max.x && z >= entry.min.z && z <= entry.max.z) out.push_back(entry.item);
+        }
+    }
+
+    // Boxes whose XZ footprint comes closer than radius to the point
+    void queryRadius(float x, float z, float radius, std::vector<uint32_t>& out) const {
+        out.clear();
+        forEachCandidate(glm::vec2(x - radius, z - radius), glm::vec2(x + radius, z + radius), [&](const Entry& entry, bool owner) {
+            if (owner && footprintDistance2(entry, x, z) < radius * radius) out.push_back(entry.item);
+            return false;
+        });
+    }
+
+    // Early out version of queryRadius (ex: is this spawn point clear of the towers)
+    bool anyWithinRadius(float x, float z, float radius) const {
+        return forEachCandidate(glm::vec2(x - radius, z - radius), glm::vec2(x + radius, z + radius), [&](const Entry& entry, bool) {
+            return footprintDistance2(entry, x, z) < radius * radius;
+        });
+    }
+
+    // Boxes overlapping the box [boxMin, boxMax] (all 3 axes)
+    void queryAABB(const glm::vec3& boxMin, const glm::vec3& boxMax, std::vector<uint32_t>& out) const {
+        out.clear();
+        forEachCandidate(glm::vec2(boxMin.x, boxMin.z), glm::vec2(boxMax.x, boxMax.z), [&](const Entry& entry, bool owner) {
+            if (owner && boxMin.y <= entry.max.y && boxMax.y >= entry.min.y) out.push_back(entry.item);
+            return false;
+        });
+    }
+
+    // First box along the segment a -> b: t in [0, 1] of the contact and its
+    // index. The cells under the segment are walked in order with a 2D DDA
+    // (the boxes stand on the ground, so the XZ columns are the 3D cells) and
+    // the walk stops at the first cell entered past the closest hit so far.
+    // The cost only depends on the segment length and the boxes per cell,
+    // never on the number of boxes.
+    bool segmentQuery(const glm::vec3& a, const glm::vec3& b, float& t, uint32_t& item) const {
+        t = 2.0f;
+        glm::vec3 d = b - a;
+        glm::vec3 invD(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);   // +-inf on the flat axes, the slabs still work
+        walkSegment(a, b, [&](size_t cell, float tEnter) {
+            if (tEnter > t) return true;
+            for (uint32_t e = mCellStart[cell]; e < mCellStart[cell + 1]; ++e) {
+                const Entry& entry = mEntries[e];
+                glm::vec3 t0 = (entry.min - a) * invD, t1 = (entry.max - a) * invD;
+                glm::vec3 tNear = glm::min(t0, t1), tFar = glm::max(t0, t1);
+                float hitIn = std::max({ tNear.x, tNear.y, tNear.z, 0.0f });
+                float hitOut = std::min({ tFar.x, tFar.y, tFar.z, 1.0f });
+                if (hitIn <= hitOut && hitIn < t) {
+                    t = hitIn;
+                    item = entry.item;
+                }
+            }
+            return false;
+        });
+        return t <= 1.0f;
+    }
+
+    // Visit the cells crossed by the XZ projection of a -> b in order, with the
+    // segment t where it enters each one, until fn returns true
+    template <typename Fn>
+    void walkSegment(const glm::vec3& a, const glm::vec3& b, Fn&& fn) const {
+        if (mEntries.empty()) return;
+        float dx = b.x - a.x, dz = b.z - a.z;
+        float gridMaxX = mOriginX + mCellsX * mCellSize, gridMaxZ = mOriginZ + mCellsZ * mCellSize;
+
+        // Clip the segment to the grid rectangle
+        float tStart = 0.0f, tEnd = 1.0f;
+        auto clip = [&](float origin, float delta, float lo, float hi) {
+            if (std::abs(delta) < 1e-12f) return origin >= lo && origin <= hi;
+            float t0 = (lo - origin) / delta, t1 = (hi - origin) / delta;
+            if (t0 > t1) std::swap(t0, t1);
+            tStart = std::max(tStart, t0);
+            tEnd = std::min(tEnd, t1);
+            return tStart <= tEnd;
+        };
+        if (!clip(a.x, dx, mOriginX, gridMaxX) || !clip(a.z, dz, mOriginZ, gridMaxZ)) return;
+
+        int x = cellX(a.x + dx * tStart), z = cellZ(a.z + dz * tStart);
+        int stepX = dx > 0.0f ? 1 : -1, stepZ = dz > 0.0f ? 1 : -1;
+        auto firstCrossing = [&](float origin, float delta, float gridOrigin, int cell) {
+            if (std::abs(delta) < 1e-12f) return 1e30f;
+            float boundary = gridOrigin + (cell + (delta > 0.0f ? 1 : 0)) * mCellSize;
+            return (boundary - origin) / delta;
+        };
+        float tNextX = firstCrossing(a.x, dx, mOriginX, x), tNextZ = firstCrossing(a.z, dz, mOriginZ, z);
+        float tDeltaX = std::abs(dx) < 1e-12f ? 1e30f : mCellSize / std::abs(dx);
+        float tDeltaZ = std::abs(dz) < 1e-12f ? 1e30f : mCellSize / std::abs(dz);
+
+        float tEnter = tStart;
+        for (;;) {
+            if (fn(cellIndex(x, z), tEnter)) return;
+            if (tNextX < tNextZ) {
+                tEnter = tNextX;
+                tNextX += tDeltaX;
+                x += stepX;
+            } else {
+                tEnter = tNextZ;
+                tNextZ += tDeltaZ;
+                z += stepZ;
+            }
+            if (tEnter > tEnd || x < 0 || z < 0 || x >= mCellsX || z >= mCellsZ) return;
+        }
+    }
+
+private:
+    float mOriginX = 0.0f, mOriginZ = 0.0f;
+    float mCellSize = SPATIAL_GRID_CELL_SIZE, mInvCellSize = 1.0f / SPATIAL_GRID_CELL_SIZE;
+    int mCellsX = 0, mCellsZ = 0;
+    std::vector<uint32_t> mCellStart;   // cellCount() + 1 offsets into mEntries
+    std::vector<Entry> mEntries;
+
+    int cellX(float x) const { return std::clamp(static_cast<int>(std::floor((x - mOriginX) * mInvCellSize)), 0, mCellsX - 1); }
+    int cellZ(float z) const { return std::clamp(static_cast<int>(std::floor((z - mOriginZ) * mInvCellSize)), 0, mCellsZ - 1); }
+    size_t cellIndex(int x, int z) const { return static_cast<size_t>(z) * mCellsX + x; }
+
+    bool insideGrid(float x, float z) const {
+        return !mEntries.empty() && x >= mOriginX && z >= mOriginZ &&
+               x <= mOriginX + mCellsX * mCellSize && z <= mOriginZ + mCellsZ * mCellSize;
+    }
+
+    static float footprintDistance2(const Entry& entry, float x, float z) {
+        float dx = std::max({ entry.min.x - x, 0.0f, x - entry.max.x });
+        float dz = std::max({ entry.min.z - z, 0.0f, z - entry.max.z });
+        return dx * dx + dz * dz;
+    }
+
+    // Visit the entries of every cell overlapping the XZ rectangle whose
+    // footprint overlaps it too. `owner` is true in exactly one of the cells a
+    // box is seen from. Stops and returns true as soon as fn returns true.
+    template <typename Fn>
+    bool forEachCandidate(const glm::vec2& lo, const glm::vec2& hi, Fn&& fn) const {
+        if (mEntries.empty() || hi.x < mOriginX || hi.y < mOriginZ ||
+            lo.x > mOriginX + mCellsX * mCellSize || lo.y > mOriginZ + mCellsZ * mCellSize) return false;
+        int x0 = cellX(lo.x), x1 = cellX(hi.x);
+        int z0 = cellZ(lo.y), z1 = cellZ(hi.y);
+        for (int z = z0; z <= z1; ++z)
+            for (int x = x0; x <= x1; ++x) {
+                size_t cell = cellIndex(x, z);
+                for (uint32_t e = mCellStart[cell]; e < mCellStart[cell + 1]; ++e) {
+                    const Entry& entry = mEntries[e];
+                    if (entry.max.x < lo.x || entry.min.x > hi.x || entry.max.z < lo.y || entry.min.z > hi.y) continue;
+                    bool owner = cellX(std::max(entry.min.x, lo.x)) == x && cellZ(std::max(entry.min.z, lo.y)) == z;
+                    if (fn(entry, owner)) return true;
+                }
+            }
+        return false;
+    }
+};
+
+// Dynamic grid for moving spheres of one radius (the monsters), rebuilt every
+// frame. The XZ cells are hashed into a table of about two buckets per sphere
+// so the memory follows the number of spheres and not the area they cover,
+// and each sphere is inserted once, by its center, with the same counting
+// sort into CSR buckets as SpatialGrid. Queries look at the cells around
+// the query inflated by the radius; spheres of other cells that share a
+// bucket are skipped by comparing their cell.
+// ---------------------------------------------------------------------------
+class SphereGrid {
+public:
+    void build(const float* x, const float* y, const float* z, size_t count, float radius, float cellSize) {
+        mRadius = radius;
+        mCellSize = cellSize;
+        mInvCellSize = 1.0f / cellSize;
+        size_t buckets = 64;
+        while (buckets < 2 * count) buckets *= 2;
+        mMask = buckets - 1;
+
+        mBucketStart.assign(buckets + 1, 0);
+        mCellKeys.resize(count);
+        for (size_t i = 0; i < count; ++i) {
+            mCellKeys[i] = cellKey(cellOf(x[i]), cellOf(z[i]));
+            ++mBucketStart[(bucketOf(mCellKeys[i])) + 1];
+        }
+        for (size_t b = 1; b < mBucketStart.size(); ++b) mBucketStart[b] += mBucketStart[b - 1];
+        mEntries.resize(count);
+        mCursor.assign(mBucketStart.begin(), mBucketStart.end() - 1);
+        for (size_t i = 0; i < count; ++i)
+            mEntries[mCursor[bucketOf(mCellKeys[i])]++] = { glm::vec3(x[i], y[i], z[i]), static_cast<uint32_t>(i), mCellKeys[i] };
+    }
+
+    size_t bucketCount() const { return mBucketStart.empty() ? 0 : mBucketStart.size() - 1; }
+    size_t size() const { return mEntries.size(); }
+
+    // First sphere along the segment a -> b: t in [0, 1] of the contact and its index
+    bool segmentQuery(const glm::vec3& a, const glm::vec3& b, float& t, uint32_t& item) const {
+        t = 2.0f;
+        forEachNear(glm::vec2(std::min(a.x, b.x), std::min(a.z, b.z)), glm::vec2(std::max(a.x, b.x), std::max(a.z, b.z)),
+                    [&](const Entry& entry) {
+            float hit;
+            if (segmentEntersSphere(a, b, entry.center, mRadius, hit) && hit < t) {
+                t = hit;
+                item = entry.item;
+            }
+        });
+        return t <= 1.0f;
+    }
+
+    // Spheres overlapping the one at center (ex: spawn points not on another monster)
+    void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& out) const {
+        out.clear();
+        float reach = (radius + mRadius) * (radius + mRadius);
+        forEachNear(glm::vec2(center.x - radius, center.z - radius), glm::vec2(center.x + radius, center.z + radius),
+                    [&](const Entry& entry) {
+            glm::vec3 d = entry.center - center;
+            if (glm::dot(d, d) < reach) out.push_back(entry.item);
+        });
+    }
+
+private:
+    struct Entry {
+        glm::vec3 center;
+        uint32_t item;
+        uint64_t cell;
+    };
+
+    float mRadius = 1.0f;
+    float mCellSize = 4.0f, mInvCellSize = 0.25f;
+    size_t mMask = 0;
+    std::vector<uint32_t> mBucketStart;   // bucketCount() + 1 offsets into mEntries
+    std::vector<Entry> mEntries;
+    std::vector<uint64_t> mCellKeys;      // build scratch
+    std::vector<uint32_t> mCursor;
+
+    int32_t cellOf(float v) const { return static_cast<int32_t>(std::floor(v * mInvCellSize)); }
+    static uint64_t cellKey(int32_t x, int32_t z) { return uint64_t(uint32_t(x)) << 32 | uint32_t(z); }
+    size_t bucketOf(uint64_t key) const { return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> 32) & mMask; }
+
+    // Visit the spheres whose center lies in a cell touching the XZ rectangle inflated by the radius
+    template <typename Fn>
+    void forEachNear(const glm::vec2& lo, const glm::vec2& hi, Fn&& fn) const {
+        if (mEntries.empty()) return;
+        int32_t x0 = cellOf(lo.x - mRadius), x1 = cellOf(hi.x + mRadius);
+        int32_t z0 = cellOf(lo.y - mRadius), z1 = cellOf(hi.y + mRadius);
+        for (int32_t z = z0; z <= z1; ++z)
+            for (int32_t x = x0; x <= x1; ++x) {
+                uint64_t key = cellKey(x, z);
+                size_t bucket = bucketOf(key);
+                for (uint32_t e = mBucketStart[bucket]; e < mBucketStart[bucket + 1]; ++e)
+                    if (mEntries[e].cell == key) fn(mEntries[e]);
+            }
+    }
+};
@@ -0,0 +1,184 @@
+#pragma once
+
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+#include "frustum.h"
+#include "renderer.h"
+
+// A box that never moves: unit cube scaled by size and centered on center
+struct StaticBox {
+    glm::vec3 center;
+    glm::vec3 size;
+};
+
+// Static geometry baked at startup into one pre-transformed vertex/index buffer.
+// Boxes are grouped into square XZ chunks; each chunk is a contiguous index range
+// drawn with one glDrawElements and has its own bounds for frustum culling.
+// Vertex layout matches the light cube (position, normal, uv) so Phong and
+// ShadowDepth shaders work unchanged with an identity world matrix.
+// -------------------------------------------------------------------------------
+class StaticBatch {
+public:
+    void build(const std::vector<StaticBox>& boxes, float chunkSize) {
+        chunks.clear();
+        chunkBounds = AABBList();
+
+        // Sort the boxes by chunk so each chunk ends up contiguous
+        auto chunkOf = [&](const StaticBox& box) {
+            return std::make_pair(static_cast<int>(std::floor(box.center.z / chunkSize)),
+                                  static_cast<int>(std::floor(box.center.x / chunkSize)));
+        };
+        std::vector<size_t> order(boxes.size());
+        for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return chunkOf(boxes[a]) < chunkOf(boxes[b]);
+        });
+
+        std::vector<float> vertices;
+        std::vector<uint32_t> indices;
+        vertices.reserve(boxes.size() * 24 * 8);
+        indices.reserve(boxes.size() * 36);
+
+        for (size_t i = 0; i < order.size(); ) {
+            auto key = chunkOf(boxes[order[i]]);
+            Chunk chunk;
+            chunk.firstIndex = static_cast<GLuint>(indices.size());
+            glm::vec3 lo(1e30f), hi(-1e30f);
+            for (; i < order.size() && chunkOf(boxes[order[i]]) == key; ++i) {
+                const StaticBox& box = boxes[order[i]];
+                appendBox(box, vertices, indices);
+                lo = glm::min(lo, box.center - 0.5f * box.size);
+                hi = glm::max(hi, box.center + 0.5f * box.size);
+            }
+            chunk.indexCount = static_cast<GLsizei>(indices.size() - chunk.firstIndex);
+            chunks.push_back(chunk);
+            chunkBounds.push(0.5f * (lo + hi), 0.5f * (hi - lo));
+        }
+
+        if (VAO == 0) {
+            glGenVertexArrays(1, &VAO);
+            glGenBuffers(1, &VBO);
+            glGenBuffers(1, &EBO);
+        }
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+        // position
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        // normal
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        // texCoord
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+        glEnableVertexAttribArray(2);
+        // keep the EBO bound to the VAO
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        std::cout << "BATCH LOG: " << boxes.size() << " boxes baked into " << chunks.size() << " chunks ("
+                  << vertices.size() * sizeof(float) / (1024 * 1024) << " MB of vertices)" << std::endl;
+    }
+
+    // Draw the chunks touching the frustum (all of them when frustum is null),
+    // returns how many chunks were drawn
+    size_t draw(const Frustum* frustum) {
+        if (chunks.empty()) return 0;
+        glBindVertexArray(VAO);
+        size_t drawn = 0;
+        if (frustum == nullptr) {
+            for (const auto& chunk : chunks) drawChunk(chunk, 1);
+            drawn = chunks.size();
+        }
+        else {
+            cullAABBs(*frustum, chunkBounds, visibleChunks);
+            for (uint32_t index : visibleChunks) drawChunk(chunks[index], 1);
+            drawn = visibleChunks.size();
+        }
+        glBindVertexArray(0);
+        return drawn;
+    }
+
+    // Draw every chunk once per frustum it touches (ex: the layers of a layered
+    // shadow pass, culling is off when cull is false). setSlots(mask) gets the
+    // frustums of a chunk as bits and returns the instances to draw it with.
+    // Returns how many chunks were drawn.
+    template <typename SetSlots>
+    size_t drawLayered(const Frustum* frustums, size_t frustumCount, bool cull, SetSlots&& setSlots) {
+        if (chunks.empty() || frustumCount == 0) return 0;
+        frustumCount = std::min<size_t>(frustumCount, MAX_FRUSTUMS);
+        glBindVertexArray(VAO);
+        size_t drawn = 0;
+        if (!cull) {
+            GLsizei instances = setSlots((1u << frustumCount) - 1u);
+            for (const auto& chunk : chunks) drawChunk(chunk, instances);
+            drawn = chunks.size();
+        }
+        else {
+            for (size_t f = 0; f < frustumCount; ++f) cullAABBs(frustums[f], chunkBounds, frustumChunks[f]);
+            listMasks(frustumChunks, frustumCount, chunks.size(), marks, visibleChunks);
+            for (uint32_t index : visibleChunks) drawChunk(chunks[index], setSlots(marks[index]));
+            drawn = visibleChunks.size();
+        }
+        glBindVertexArray(0);
+        return drawn;
+    }
+
+    size_t chunkCount() const { return chunks.size(); }
+
+private:
+    struct Chunk {
+        GLuint firstIndex;
+        GLsizei indexCount;
+    };
+
+    GLuint VAO = 0, VBO = 0, EBO = 0;
+    std::vector<Chunk> chunks;
+    AABBList chunkBounds;
+    static constexpr size_t MAX_FRUSTUMS = 8;
+    std::vector<uint32_t> visibleChunks;
+    std::vector<uint32_t> frustumChunks[MAX_FRUSTUMS];
+    std::vector<uint8_t> marks;
+
+    static void drawChunk(const Chunk& chunk, GLsizei instanceCount) {
+        if (instanceCount == 1)
+            Renderer::drawElements(GL_TRIANGLES, chunk.indexCount, GL_UNSIGNED_INT,
+                                   (void*)(chunk.firstIndex * sizeof(uint32_t)));
+        else
+            Renderer::drawElementsInstanced(GL_TRIANGLES, chunk.indexCount, GL_UNSIGNED_INT,
+                                            (void*)(chunk.firstIndex * sizeof(uint32_t)), instanceCount);
+    }
+
+    // 4 vertices per face (so normals stay flat) and 2 counter-clockwise triangles
+    static void appendBox(const StaticBox& box, std::vector<float>& vertices, std::vector<uint32_t>& indices) {
+        // normal, then u and v tangent axes with cross(u, v) == normal
+        static const glm::vec3 faces[6][3] = {
+            { glm::vec3( 0, 0, 1), glm::vec3( 1, 0, 0), glm::vec3(0, 1,  0) },
+            { glm::vec3( 0, 0,-1), glm::vec3(-1, 0, 0), glm::vec3(0, 1,  0) },
+            { glm::vec3( 1, 0, 0), glm::vec3( 0, 0,-1), glm::vec3(0, 1,  0) },
+            { glm::vec3(-1, 0, 0), glm::vec3( 0, 0, 1), glm::vec3(0, 1,  0) },
+            { glm::vec3( 0, 1, 0), glm::vec3( 1, 0, 0), glm::vec3(0, 0, -1) },
+            { glm::vec3( 0,-1, 0), glm::vec3( 1, 0, 0), glm::vec3(0, 0,  1) },
+        };
+        static const float corners[4][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 }, { 0, 1 } };
+
+        for (const auto& face : faces) {
+            uint32_t base = static_cast<uint32_t>(vertices.size() / 8);
+            for (const auto& uv : corners) {
+                glm::vec3 local = 0.5f * face[0] + (uv[0] - 0.5f) * face[1] + (uv[1] - 0.5f) * face[2];
+                glm::vec3 p = box.center + local * box.size;
+                vertices.insert(vertices.end(), { p.x, p.y, p.z, face[0].x, face[0].y, face[0].z, uv[0], uv[1] });
+            }
+            indices.insert(indices.end(), { base, base + 1, base + 2, base + 2, base + 3, base });
+        }
+    }
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "renderer.h"
+
+// Frame statistics, averaged and printed to the console once per second
+// ---------------------------------------------------------------------
+class FrameStats {
+public:
+    // Mark the start of the CPU work of a frame
+    void beginFrame() {
+        Renderer::resetDrawCalls();
+        frameStart = glfwGetTime();
+    }
+
+    // Add to a named per-frame counter (ex: visible towers), reported as a per-frame average
+    void add(const std::string& name, double value) {
+        for (auto& counter : counters) {
+            if (counter.first == name) { counter.second += value; return; }
+        }
+        counters.emplace_back(name, value);
+    }
+
+    // Mark the end of the CPU work of a frame (call right before swapping buffers)
+    void endFrame(const std::string& mode, size_t towerCount) {
+        double now = glfwGetTime();
+        cpuTimeSum += now - frameStart;
+        drawCallSum += Renderer::drawCalls;
+        ++frames;
+
+        if (now - windowStart < 1.0) return;
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << "[STATS] mode: " << mode
+                  << " | towers: " << towerCount
+                  << " | draw calls: " << drawCallSum / frames
+                  << " | cpu: " << 1000.0 * cpuTimeSum / frames << " ms"
+                  << " | fps: " << frames / (now - windowStart);
+        std::cout << std::setprecision(1);
+        for (const auto& counter : counters)
+            std::cout << " | " << counter.first << ": " << counter.second / frames;
+        std::cout << std::endl;
+
+        windowStart = now;
+        cpuTimeSum = 0.0;
+        drawCallSum = 0;
+        frames = 0;
+        counters.clear();
+    }
+
+private:
+    double frameStart = 0.0;
+    double windowStart = 0.0;
+    double cpuTimeSum = 0.0;
+    unsigned long drawCallSum = 0;
+    unsigned int frames = 0;
+    std::vector<std::pair<std::string, double>> counters;
+};
+
+// Result of a GL query around a section of the frame. Results are read back
+// FRAMES frames later so the CPU never waits on the GPU. Queries of the same
+// target can't be nested.
+// --------------------------------------------------------------------------
+class GpuQuery {
+public:
+    explicit GpuQuery(GLenum target) : target(target) {}
+
+    void begin() {
+        if (queries[0] == 0) glGenQueries(FRAMES, queries);
+        if (pending[index]) {
+            glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &lastValue);
+            pending[index] = false;
+            hasResult = true;
+        }
+        glBeginQuery(target, queries[index]);
+    }
+
+    void end() {
+        glEndQuery(target);
+        pending[index] = true;
+        index = (index + 1) % FRAMES;
+    }
+
+    bool ready() const { return hasResult; }
+    GLuint64 value() const { return lastValue; }
+
+private:
+    static constexpr int FRAMES = 4;
+    GLenum target;
+    GLuint queries[FRAMES] = {};
+    bool pending[FRAMES] = {};
+    int index = 0;
+    bool hasResult = false;
+    GLuint64 lastValue = 0;
+};
+
+// GPU time of a section of the frame (GL_TIME_ELAPSED)
+class GpuTimer : public GpuQuery {
+public:
+    GpuTimer() : GpuQuery(GL_TIME_ELAPSED) {}
+    double milliseconds() const { return value() / 1.0e6; }
+};
+
+// Samples that passed the depth test in a section of the frame (GL_SAMPLES_PASSED),
+// the number of fragments that were shaded and written
+class GpuSampleCounter : public GpuQuery {
+public:
+    GpuSampleCounter() : GpuQuery(GL_SAMPLES_PASSED) {}
+    GLuint64 samples() const { return value(); }
+};
@@ -8,6 +8,8 @@
 #include <iostream>
 #include <cassert>
 
+#include "parallel.h"
+
 class Texture {
 public:
     // Load and create textures from a jpeg file
@@ -44,6 +46,45 @@ public:
         std::cout << "TEXTURE LOG: Loaded texture: " << filename << " (ID: " << textureID << ")" << std::endl;
         return textureID;
     }
+
+    // Load a cubemap from six images in +X, -X, +Y, -Y, +Z, -Z order. The faces
+    // are decoded in parallel, only the upload runs on the GL thread
+    // --------------------------------------------------------------------------
+    static GLuint loadCubemap(const char* const faces[6]) {
+        struct Face { unsigned char* data = nullptr; int width = 0, height = 0, channels = 0; };
+        Face decoded[6];
+        stbi_set_flip_vertically_on_load(false);   // cubemaps are top-down, set before the threads start
+        parallelFor(6, 1, [&](size_t, size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                decoded[i].data = stbi_load(faces[i], &decoded[i].width, &decoded[i].height, &decoded[i].channels, 0);
+        });
+
+        GLuint textureID;
+        glGenTextures(1, &textureID);
+        assert(textureID != 0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int i = 0; i < 6; ++i) {
+            if (!decoded[i].data) {
+                std::cerr << "Failed to load cubemap face: " << faces[i] << std::endl;
+                continue;
+            }
+            GLenum format = decoded[i].channels == 4 ? GL_RGBA : decoded[i].channels == 1 ? GL_RED : GL_RGB;
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, format, decoded[i].width, decoded[i].height, 0,
+                         format, GL_UNSIGNED_BYTE, decoded[i].data);
+            stbi_image_free(decoded[i].data);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+        std::cout << "TEXTURE LOG: Loaded cubemap: " << faces[0] << " ... (ID: " << textureID << ")" << std::endl;
+        return textureID;
+    }
 };
 
 #endif
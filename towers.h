@@ -0,0 +1,168 @@
+#pragma once
+
+#define GLEW_STATIC 1   // This allows linking with Static Library on Windows, without DLL
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+
+#include "geometry.h"
+#include "renderer.h"
+
+struct Tower {
+    glm::vec3 position;
+    float height;
+};
+
+// Tower footprint, towers are unit cubes scaled by (TOWER_WIDTH, height, TOWER_WIDTH)
+constexpr float TOWER_WIDTH = 2.0f;
+
+// How the towers are submitted to OpenGL, cycled at runtime with M
+// ----------------------------------------------------------------
+enum class TowerRenderMode {
+    PerTower,   // one uniform upload + glDrawArrays per tower
+    Instanced,  // one glDrawArraysInstanced for the whole city
+    Batched,    // pre-transformed static chunks, one glDrawElements per chunk
+    GpuDriven,  // compute shader culling + glMultiDrawArraysIndirect
+    HwOcclusion,// per cluster draws under conditional rendering from occlusion queries
+    Count
+};
+
+inline const char* towerRenderModeName(TowerRenderMode mode) {
+    switch (mode) {
+        case TowerRenderMode::PerTower:  return "PerTower";
+        case TowerRenderMode::Instanced: return "Instanced";
+        case TowerRenderMode::Batched:   return "Batched";
+        case TowerRenderMode::GpuDriven: return "GpuDriven";
+        case TowerRenderMode::HwOcclusion: return "HwOcclusion";
+        default:                         return "Unknown";
+    }
+}
+
+// Random city generation with rand(), seed it with srand() first. The area grows
+// with the tower count so the density stays the same as with 100 towers.
+// Returns the half extent of the city in X and Z.
+// -------------------------------------------------------------------------------
+inline float generateTowers(int numTowers, std::vector<Tower>& towers) {
+    float minDist = 5.0f;
+    float maxRange = 40.0f * std::max(1.0f, std::sqrt(numTowers / 100.0f));
+    towers.reserve(towers.size() + numTowers);
+    for (int i = 0; i < numTowers; ++i) {
+        float x = static_cast<float>((rand() % static_cast<int>(2 * maxRange)) - static_cast<int>(maxRange));
+        float z = static_cast<float>((rand() % static_cast<int>(2 * maxRange)) - static_cast<int>(maxRange));
+        if (glm::length(glm::vec2(x, z)) < minDist) continue;
+        float height = 5.0f + static_cast<float>(rand() % 20);
+        towers.push_back({ glm::vec3(x, 0.0f, z), height });
+    }
+    return maxRange;
+}
+
+// Tower bounds as center + half extent (the unit cube is centered on the tower position)
+inline glm::vec3 towerExtent(const Tower& tower) {
+    return glm::vec3(0.5f * TOWER_WIDTH, 0.5f * tower.height, 0.5f * TOWER_WIDTH);
+}
+
+// Static per-instance data of the towers, packed once after generation
+// and drawn with a single instanced call in both the shadow and lighting passes
+// -----------------------------------------------------------------------------
+class TowerInstances {
+public:
+    GLuint VAO = 0;
+    GLuint instanceVBO = 0;
+    GLsizei count = 0;
+
+    void create(Geometry& geometry, const std::vector<Tower>& towers) {
+        instances.clear();
+        instances.reserve(towers.size());
+        for (const auto& tower : towers)
+            instances.push_back(glm::vec4(tower.position, tower.height));
+
+        glGenBuffers(1, &instanceVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(glm::vec4), instances.data(), GL_STATIC_DRAW);
+
+        // Second buffer for culled subsets, refilled every time a partial list is drawn
+        glGenBuffers(1, &visibleVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, visibleVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        VAO = geometry.createInstancedLightCube(instanceVBO);
+        visibleVAO = geometry.createInstancedLightCube(visibleVBO);
+        // Positions only, for the shadow pass
+        depthVAO = geometry.createInstancedDepthCube(instanceVBO);
+        visibleDepthVAO = geometry.createInstancedDepthCube(visibleVBO);
+        // (tower, layer) pairs for the layered shadow pass
+        glGenBuffers(1, &pairVBO);
+        glGenBuffers(1, &slotVBO);
+        pairDepthVAO = geometry.createInstancedDepthCube(pairVBO);
+        Geometry::addLayerSlots(pairDepthVAO, slotVBO);
+        count = static_cast<GLsizei>(instances.size());
+    }
+
+    // Draw every tower, the bound shader must have useInstancing = true
+    void draw(bool depthOnly = false) const {
+        if (count == 0) return;
+        glBindVertexArray(depthOnly ? depthVAO : VAO);
+        Renderer::drawArraysInstanced(GL_TRIANGLES, 0, 36, count);
+        glBindVertexArray(0);
+    }
+
+    // Draw only the listed towers (ex: the output of frustum culling)
+    void draw(const std::vector<uint32_t>& visible, bool depthOnly = false) {
+        if (visible.size() == static_cast<size_t>(count)) { draw(depthOnly); return; }
+        if (visible.empty()) return;
+
+        staging.resize(visible.size());
+        for (size_t i = 0; i < visible.size(); ++i)
+            staging[i] = instances[visible[i]];
+
+        // Orphan the previous contents so we don't wait on the draw still reading them
+        glBindBuffer(GL_ARRAY_BUFFER, visibleVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(glm::vec4), NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, staging.size() * sizeof(glm::vec4), staging.data());
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glBindVertexArray(depthOnly ? visibleDepthVAO : visibleVAO);
+        Renderer::drawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(staging.size()));
+        glBindVertexArray(0);
+    }
+
+    // Layered depth draw of one (tower, layer) pair per tower of each list:
+    // lists[i] holds the towers culled into layer slot i. The bound shader
+    // must have useInstancing and useLayerSlots = true. Returns the pairs drawn.
+    size_t drawLayered(const std::vector<uint32_t>* lists, int listCount) {
+        staging.clear();
+        slots.clear();
+        for (int slot = 0; slot < listCount; ++slot) {
+            for (uint32_t index : lists[slot]) staging.push_back(instances[index]);
+            slots.resize(staging.size(), static_cast<uint8_t>(slot));
+        }
+        if (staging.empty()) return 0;
+
+        // Orphan and refill, the pair count changes every frame
+        glBindBuffer(GL_ARRAY_BUFFER, pairVBO);
+        glBufferData(GL_ARRAY_BUFFER, staging.size() * sizeof(glm::vec4), staging.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, slotVBO);
+        glBufferData(GL_ARRAY_BUFFER, slots.size(), slots.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glBindVertexArray(pairDepthVAO);
+        Renderer::drawArraysInstanced(GL_TRIANGLES, 0, 36, static_cast<GLsizei>(staging.size()));
+        glBindVertexArray(0);
+        return staging.size();
+    }
+
+private:
+    GLuint visibleVAO = 0;
+    GLuint visibleVBO = 0;
+    GLuint depthVAO = 0;
+    GLuint visibleDepthVAO = 0;
+    GLuint pairVBO = 0, slotVBO = 0, pairDepthVAO = 0;
+    std::vector<glm::vec4> instances;  // CPU copy, gathered from when drawing a subset
+    std::vector<glm::vec4> staging;
+    std::vector<uint8_t> slots;        // layer slot of each staged pair
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free triple buffer between one writer thread and one reader thread.
+// The writer fills its slot and publishes it, the reader takes the newest
+// published slot whenever it wants. Neither side ever waits for the other:
+// there is always a third slot to swap with, and a slot the reader did not
+// get to in time is simply overwritten (only the newest one matters).
+// ---------------------------------------------------------------------------
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer side: fill writeBuffer() then publish() it (the writer gets another slot)
+    T& writeBuffer() { return mSlots[mWrite]; }
+    void publish() {
+        uint8_t previous = mMiddle.exchange(static_cast<uint8_t>(mWrite | FRESH), std::memory_order_acq_rel);
+        mWrite = previous & INDEX;
+    }
+
+    // Reader side: take the newest published slot, false if nothing new was published
+    bool acquire() {
+        if (!(mMiddle.load(std::memory_order_relaxed) & FRESH)) return false;
+        uint8_t previous = mMiddle.exchange(mRead, std::memory_order_acq_rel);
+        mRead = previous & INDEX;
+        return true;
+    }
+    const T& readBuffer() const { return mSlots[mRead]; }
+
+private:
+    static constexpr uint8_t INDEX = 0x3;   // slot of the middle buffer
+    static constexpr uint8_t FRESH = 0x4;   // published and not taken yet
+
+    T mSlots[3];
+    uint8_t mWrite = 0;                     // only touched by the writer
+    uint8_t mRead = 1;                      // only touched by the reader
+    std::atomic<uint8_t> mMiddle{ 2 };
+};